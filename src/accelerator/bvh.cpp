@@ -22,7 +22,24 @@ namespace pol {
 		}
 
 		int nextFree = 0;
-		split(primitives, rootBBox, nextFree);
+		split(primitives, rootBBox, linearNodes, nextFree);
+
+		//group primitives by bssrdf and build hierarchy for each group
+		map<const Bssrdf*, vector<Shape*>> objects;
+		for (Shape* shape : primitives) {
+			const Bssrdf* bssrdf = shape->GetBssrdf();
+			if (bssrdf) objects[bssrdf].push_back(shape);
+		}
+
+		for (auto& object : objects) {
+			BBox objectBBox;
+			for (const Shape* shape : object.second) {
+				objectBBox.Union(shape->WorldBBox());
+			}
+
+			int objectNextFree = 0;
+			split(object.second, objectBBox, objectNodes[object.first], objectNextFree);
+		}
 
 		return true;
 	}
@@ -38,10 +55,10 @@ namespace pol {
 		return leaf;
 	}
 
-	void Bvh::split(const vector<Shape*>& primitives, const BBox& bbox, int& nextFree) {
+	void Bvh::split(const vector<Shape*>& primitives, const BBox& bbox, vector<BvhNode*>& nodes, int& nextFree) {
 		//create a leaf if the number of primitives is small
 		if (primitives.size() < 4) {
-			linearNodes.push_back(createLeaf(primitives, bbox));
+			nodes.push_back(createLeaf(primitives, bbox));
 
 			return;
 		}
@@ -100,7 +117,7 @@ namespace pol {
 
 		//can not find axis to split, then just create leaf
 		if (bestAxis == -1) {
-			linearNodes.push_back(createLeaf(primitives, bbox));
+			nodes.push_back(createLeaf(primitives, bbox));
 
 			return;
 		}
@@ -130,14 +147,25 @@ namespace pol {
 		BvhNode* node = new BvhNode();
 		node->bbox = bbox;
 		node->axis = bestAxis;
-		linearNodes.push_back(node);
+		nodes.push_back(node);
 		nextFree++;
-		split(left, leftBBox, nextFree);
+		split(left, leftBBox, nodes, nextFree);
 		node->right = ++nextFree;
-		split(right, rightBBox, nextFree);
+		split(right, rightBBox, nodes, nextFree);
 	}
 
 	bool Bvh::Intersect(Ray& ray, Intersection& isect) const {
+		return intersect(linearNodes, ray, isect);
+	}
+
+	bool Bvh::IntersectObject(const Bssrdf* object, Ray& ray, Intersection& isect) const {
+		auto it = objectNodes.find(object);
+		if (it == objectNodes.end()) return false;
+
+		return intersect(it->second, ray, isect);
+	}
+
+	bool Bvh::intersect(const vector<BvhNode*>& nodes, Ray& ray, Intersection& isect) const {
 		int stack[64];
 		int stackTop = 0;
 		int nodeIdx = 0;
@@ -151,7 +179,7 @@ namespace pol {
 			if (!stackTop) break;
 
 			nodeIdx = stack[--stackTop];
-			BvhNode* node = linearNodes[nodeIdx];
+			BvhNode* node = nodes[nodeIdx];
 			if (node->bbox.Intersect(ray, invDir)) {
 				if (node->isleaf) {
 					for (const Shape* shape : node->primitives) {
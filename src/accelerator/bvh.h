@@ -22,6 +22,8 @@ namespace pol {
 
 	private:
 		vector<BvhNode*> linearNodes;
+		//separate hierarchy for each subsurface object
+		map<const Bssrdf*, vector<BvhNode*>> objectNodes;
 
 	public:
 		Bvh(const PropSets& props, Scene& scene);
@@ -36,12 +38,14 @@ namespace pol {
 
 		virtual bool Build(const vector<Shape*>& primitives);
 		virtual bool Intersect(Ray& ray, Intersection& isect) const;
+		virtual bool IntersectObject(const Bssrdf* object, Ray& ray, Intersection& isect) const;
 		virtual bool Occluded(const Ray& ray) const;
 
 		virtual string ToString() const;
 
 	private:
-		void split(const vector<Shape*>& primitives, const BBox& bbox, int& nextFree);
+		void split(const vector<Shape*>& primitives, const BBox& bbox, vector<BvhNode*>& nodes, int& nextFree);
+		bool intersect(const vector<BvhNode*>& nodes, Ray& ray, Intersection& isect) const;
 		BvhNode* createLeaf(const vector<Shape*>& primitives, const BBox& bbox) const;
 	};
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 namespace pol {
 	class Intersection;
 	class Shape;
+	class Bssrdf;
 	class Accelerator : public PolObject {
 	public:
 		Accelerator(const PropSets& props, Scene& scene);
@@ -14,6 +15,9 @@ namespace pol {
 		virtual int GetNodesCount() const = 0;
 		virtual bool Build(const vector<Shape*>& primitives) = 0;
 		virtual bool Intersect(Ray& ray, Intersection& isect) const = 0;
+		//intersect only primitives of one object, the object is all primitives
+		//sharing the same bssrdf, so probe rays never traverse unrelated geometry
+		virtual bool IntersectObject(const Bssrdf* object, Ray& ray, Intersection& isect) const = 0;
 		virtual bool Occluded(const Ray& ray) const = 0;
 	};
 }
\ No newline at end of file
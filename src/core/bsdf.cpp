@@ -2,6 +2,10 @@
 #include "scene.h"
 
 namespace pol {
+	Bsdf::Bsdf() {
+
+	}
+
 	Bsdf::Bsdf(const PropSets& props, Scene& scene) {
 		string bsdfName = props.GetString("name");
 		scene.AddBsdf(bsdfName, this);
@@ -10,6 +10,8 @@
 namespace pol {
 	class Bsdf : public PolObject {
 	public:
+		//bsdf which is not created from scene description
+		Bsdf();
 		Bsdf(const PropSets& props, Scene& scene);
 		virtual ~Bsdf();
 
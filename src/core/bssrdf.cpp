@@ -2,8 +2,23 @@
 #include "bsdf.h"
 #include "warp.h"
 #include "scene.h"
+#include "catmullrom.h"
+#include "parallel.h"
 
 namespace pol {
+	Bssrdf::Bssrdf() {
+
+	}
+
+	Bssrdf::Bssrdf(const PropSets& props, Scene& scene) {
+		string bssrdfName = props.GetString("name");
+		scene.AddBssrdf(bssrdfName, this);
+	}
+
+	Bssrdf::~Bssrdf() {
+
+	}
+
 	JensenBssrdf::JensenBssrdf(const Vector3f& absorb, const Vector3f& scatter, Float eta, Float g)
 		:absorb(absorb), scatter(scatter)
 		, eta(eta), g(g) {
@@ -133,7 +148,7 @@ namespace pol {
 		Float pdf;
 		sampleProbeRay(isect, sampler->Next2D(), sigmaTr, rMax, probeRay, pdf);
 		Intersection probeIsect;
-		while (scene.Intersect(probeRay, probeIsect)) {
+		while (scene.IntersectObject(this, probeRay, probeIsect)) {
 			if (probeIsect.bssrdf) {
 				Vector3f Rd = rd((probeIsect.p - p).LengthSquare());
 
@@ -166,136 +181,381 @@ namespace pol {
 		return ms;
 	}
 
-	//Float FresnelMoment1(Float eta) {
-	//	Float eta2 = eta * eta, eta3 = eta2 * eta, eta4 = eta3 * eta, eta5 = eta4 * eta;
-	//	if (eta < 1) {
-	//		return 0.45966f - 1.73965f * eta + 3.37668f * eta2 - 3.904945 * eta3 +
-	//			2.49277f * eta4 - 0.68441f * eta5;
-	//	}
-	//	else {
-	//		return -4.61686f + 11.1136f * eta - 10.4646f * eta2 + 5.11455f * eta3 -
-	//			1.27198f * eta4 + 0.12746f * eta5;
-	//	}
-
-	//}
-
-	//Float FresnelMoment2(Float eta) {
-	//	Float eta2 = eta * eta, eta3 = eta2 * eta, eta4 = eta3 * eta,
-	//		eta5 = eta4 * eta;
-	//	if (eta < 1) {
-	//		return 0.27614f - 0.87350f * eta + 1.12077f * eta2 - 0.65095f * eta3 +
-	//			0.07883f * eta4 + 0.04860f * eta5;
-	//	}
-	//	else {
-	//		Float r_eta = 1 / eta, r_eta2 = r_eta * r_eta, r_eta3 = r_eta2 * r_eta;
-	//		return -547.033f + 45.3087f * r_eta3 - 218.725f * r_eta2 +
-	//			458.843f * r_eta + 404.557f * eta - 189.519f * eta2 +
-	//			54.9327f * eta3 - 9.00603f * eta4 + 0.63942f * eta5;
-	//	}
-	//}
-
-	//void ComputeBeamDiffusionBssrdf(Float g, Float eta) {
-
-	//}
-
-	//Vector3f SeparableBssrdf::Sw(const Vector3f& w) const {
-	//	Float c = 1 - 2 * FresnelMoment1(1 / eta);
-	//	Float cosi = Frame::AbsCosTheta(w);
-	//	Float sint2 = Frame::SinTheta2(w) / eta;
-	//	Float cost = sqrt(Clamp(1 - sint2, Float(0), Float(1)));
-	//	return (1 - DielectricFresnel(cosi, cost, 1, eta)) / (c * PI);
-	//}
-
-	//TabulatedBssrdf::TabulatedBssrdf(const Intersection& isect, Float eta, const Vector3f& sigmaA, const Vector3f& sigmaS, const BssrdfTable& table) 
-	//	:table(table){
-	//	sigmaT = sigmaA + sigmaS;
-	//	albedo = sigmaS / sigmaT;
-	//	if (isnan(albedo.X())) albedo[0] = 0;
-	//	if (isnan(albedo.Y())) albedo[1] = 0;
-	//	if (isnan(albedo.Z())) albedo[2] = 0;
-	//}
-
-	//BssrdfTable::BssrdfTable(int nRhoSamples, int nRadiusSamples) {
-
-	//}
-
-	//Float BssrdfTable::BeamDiffusionMS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r) {
-	//	const int nSamples = 100;
-	//	Float eD = 0;
-	//	Float sigmaSPrime = sigmaS * (1 - g);
-	//	Float sigmaTPrime = sigmaA + sigmaSPrime;
-	//	Float albedoPrime = sigmaSPrime / sigmaTPrime;
-	//	Float dG = (2 * sigmaA + sigmaSPrime) / (3 * sigmaTPrime * sigmaTPrime);
-	//	Float sigmaTr = sqrt(sigmaA / dG);
-	//	Float fm1 = FresnelMoment1(eta), fm2 = FresnelMoment2(eta);
-	//	Float ze = -2 * dG * (1 + 3 * fm2) / (1 - 2 * fm1);
-	//	Float cPhi = 0.25 * (1 - 2 * fm1), cE = 0.5 * (1 - 3 * fm2);
-
-	//	for (int i = 0; i < nSamples; ++i) {
-	//		Float zr = -log(1 - (i + 0.5) / nSamples) / sigmaTPrime;
-	//		Float zv = -zr + 2 * ze;
-	//		Float dr = sqrt(r * r + zr * zr);
-	//		Float dv = sqrt(r * r + zv * zv);
-	//		Float trdr = sigmaTr * dr;
-	//		Float trdv = sigmaTr * dv;
-	//		Float phiD = INV4PI / dG * (exp(-trdr) / dr - exp(-trdv) / dv);
-	//		Float eDn = INV4PI * (zr * (1 + trdr) * exp(-trdr) / (dr * dr * dr) -
-	//			zv * (1 + trdv) * exp(-trdv) / (dv * dv * dv));
-	//		
-	//		Float E = phiD * cPhi + eDn * cE;
-	//		//corrects an overestimation that can occur when r is small and the light source is close to
-	//		//the surface
-	//		Float kappa = 1 - exp(-2 * sigmaTPrime * (dr + zr));
-	//		//first albedoPrime factor in the scale is needed due to the ratio of the importance sampling
-	//		//weight of the sampling strategy.
-	//		//second albedoPrime factor accounts for the additional scattering event in Grosjean's nonclassical
-	//		//monopole
-	//		eD += kappa * albedoPrime * albedoPrime * E;
-	//	}
-
-	//	eD /= nSamples;
-	//	return eD;
-	//}
-
-	//Float BssrdfTable::BeamDiffusionSS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r) {
-	//	const int nSamples = 100;
-	//	Float sigmaT = sigmaA + sigmaS;
-	//	Float albedo = sigmaS / sigmaT;
-	//	Float tCrit = r * sqrt(eta * eta - 1);
-	//	Float eSS = 0;
-	//	
-	//	for (int i = 0; i < nSamples; ++i) {
-	//		Float ti = tCrit - log(1 - (i + 0.5) / nSamples) / sigmaT;
-	//		Float d = sqrt(r * r + ti * ti);
-	//		Float cost = ti / d;
-	//		Float phase = INV4PI;
-	//		eSS += albedo * exp(-sigmaT * (d + tCrit)) / (d * d) * phase *
-	//			(1 - DielectricFresnel(1, cost, 1, eta)) * abs(cost);
-	//	}
-
-	//	eSS /= nSamples;
-	//	return eSS;
-	//}
-
-	//void BssrdfTable::ComputeBeamDiffusionBssrdf(Float g, Float eta) {
-	//	radiusSamples[0] = 0;
-	//	radiusSamples[1] = 2.5e-3;
-	//	for (int i = 2; i < nRadiusSamples; ++i) {
-	//		radiusSamples[i] = radiusSamples[i - 1] * 1.2;
-	//	}
-
-	//	for (int i = 0; i < nAlbedoSamples; ++i) {
-	//		albedoSamples[i] = (1 - exp(-8 * i / Float(nAlbedoSamples - 1))) / (1 - exp(-8));
-	//	}
-
-	//	for (int i = 0; i < nAlbedoSamples; ++i) {
-	//		for (int j = 0; j < nRadiusSamples; ++j) {
-	//			Float albedo = albedoSamples[j];
-	//			Float r = radiusSamples[j];
-	//			profile[i * nRadiusSamples + j] = 2 * PI * r *
-	//				(BeamDiffusionSS(albedo, 1 - albedo, g, eta, r) +
-	//				BeamDiffusionSS(albedo, 1 - albedo, g, eta, r));
-	//		}
-	//	}
-	//}
+	string JensenBssrdf::ToString() const {
+		string ret;
+		ret += "JensenBssrdf[\n  absorb = " + absorb.ToString()
+			+ ",\n  scatter = " + scatter.ToString()
+			+ ",\n  eta = " + to_string(eta)
+			+ ",\n  g = " + to_string(g)
+			+ "\n]";
+
+		return ret;
+	}
+
+	//dielectric fresnel reflectance, cosi is negative if light comes from inside
+	static Float FrDielectric(Float cosi, Float etai, Float etat) {
+		cosi = Clamp(cosi, Float(-1), Float(1));
+		if (cosi < 0) {
+			swap(etai, etat);
+			cosi = -cosi;
+		}
+
+		Float sint = etai / etat * sqrt(Max(Float(0), 1 - cosi * cosi));
+		//total internal reflection
+		if (sint >= 1) return 1;
+
+		Float cost = sqrt(Max(Float(0), 1 - sint * sint));
+		return DielectricFresnel(cosi, cost, etai, etat);
+	}
+
+	//henyey-greenstein phase function
+	static Float PhaseHG(Float cosTheta, Float g) {
+		Float denom = 1 + g * g + 2 * g * cosTheta;
+		return INV4PI * (1 - g * g) / (denom * sqrt(denom));
+	}
+
+	//moments of fresnel reflectance, polynomial fits of
+	//      2*integral(Fr(eta, cos)*cos^i*dcos)
+	static Float FresnelMoment1(Float eta) {
+		Float eta2 = eta * eta, eta3 = eta2 * eta, eta4 = eta3 * eta, eta5 = eta4 * eta;
+		if (eta < 1) {
+			return 0.45966f - 1.73965f * eta + 3.37668f * eta2 - 3.904945 * eta3 +
+				2.49277f * eta4 - 0.68441f * eta5;
+		}
+		else {
+			return -4.61686f + 11.1136f * eta - 10.4646f * eta2 + 5.11455f * eta3 -
+				1.27198f * eta4 + 0.12746f * eta5;
+		}
+	}
+
+	static Float FresnelMoment2(Float eta) {
+		Float eta2 = eta * eta, eta3 = eta2 * eta, eta4 = eta3 * eta, eta5 = eta4 * eta;
+		if (eta < 1) {
+			return 0.27614f - 0.87350f * eta + 1.12077f * eta2 - 0.65095f * eta3 +
+				0.07883f * eta4 + 0.04860f * eta5;
+		}
+		else {
+			Float r_eta = 1 / eta, r_eta2 = r_eta * r_eta, r_eta3 = r_eta2 * r_eta;
+			return -547.033f + 45.3087f * r_eta3 - 218.725f * r_eta2 +
+				458.843f * r_eta + 404.557f * eta - 189.519f * eta2 +
+				54.9327f * eta3 - 9.00603f * eta4 + 0.63942f * eta5;
+		}
+	}
+
+	SeparableBssrdf::SeparableBssrdf(const PropSets& props, Scene& scene)
+		:Bssrdf(props, scene) {
+		eta = props.GetFloat("eta", 1.33);
+		adapter = new SeparableBssrdfAdapter(this);
+	}
+
+	SeparableBssrdf::~SeparableBssrdf() {
+		POL_SAFE_DELETE(adapter);
+	}
+
+	Vector3f SeparableBssrdf::Sw(const Vector3f& w) const {
+		Float c = 1 - 2 * FresnelMoment1(1 / eta);
+		return Vector3f((1 - FrDielectric(Frame::CosTheta(w), 1, eta)) / (c * PI));
+	}
+
+	Vector3f SeparableBssrdf::SampleS(const Scene& scene, const Intersection& isect, Float u1, const Vector2f& u2,
+		Intersection& probeIsect, Float& pdf) const {
+		pdf = 0;
+		//choose projection axis, normal is chosen with probability 0.5
+		Vector3f ss = isect.shFrame.ToWorld(Vector3f(1, 0, 0));
+		Vector3f ns = isect.shFrame.ToWorld(Vector3f(0, 1, 0));
+		Vector3f ts = isect.shFrame.ToWorld(Vector3f(0, 0, 1));
+		Vector3f vx, vy, vz;
+		if (u1 < 0.5) {
+			vx = ss; vy = ts; vz = ns;
+			u1 *= 2;
+		}
+		else if (u1 < 0.75) {
+			vx = ts; vy = ns; vz = ss;
+			u1 = (u1 - 0.5) * 4;
+		}
+		else {
+			vx = ns; vy = ss; vz = ts;
+			u1 = (u1 - 0.75) * 4;
+		}
+
+		//choose channel
+		int ch = Min(int(u1 * 3), 2);
+		u1 = u1 * 3 - ch;
+
+		//sample radius, and segment is bounded by sphere of max radius
+		Float r = SampleSr(ch, u2.x);
+		if (r < 0) return 0;
+		Float phi = TWOPI * u2.y;
+		Float rMax = SampleSr(ch, 0.999f);
+		if (r >= rMax) return 0;
+		Float l = 2 * sqrt(rMax * rMax - r * r);
+
+		Vector3f start = isect.p + r * (vx * cos(phi) + vy * sin(phi)) - l * vz * 0.5;
+		Vector3f target = start + l * vz;
+
+		//find all intersections of the object along segment
+		const int MaxProbeHits = 16;
+		Intersection hits[MaxProbeHits];
+		int nFound = 0;
+		Vector3f base = start;
+		while (nFound < MaxProbeHits) {
+			Float remain = Dot(target - base, vz);
+			if (remain <= 0) break;
+
+			Ray ray(base, vz, Epsilon, remain);
+			Intersection hit;
+			if (!scene.IntersectObject(this, ray, hit)) break;
+
+			base = hit.p;
+			hits[nFound++] = hit;
+		}
+
+		if (nFound == 0) return 0;
+
+		int selected = Min(int(u1 * nFound), nFound - 1);
+		probeIsect = hits[selected];
+		probeIsect.bsdf = adapter;
+		pdf = PdfSp(isect, probeIsect) / nFound;
+
+		return Sr((isect.p - probeIsect.p).Length());
+	}
+
+	Float SeparableBssrdf::PdfSp(const Intersection& isect, const Intersection& probeIsect) const {
+		Vector3f d = isect.p - probeIsect.p;
+		Vector3f dLocal = isect.shFrame.ToLocal(d);
+		Vector3f nLocal = isect.shFrame.ToLocal(probeIsect.n);
+		//local y axis is normal, so order of axes is (ss, ns, ts)
+		Float rProj[3] = {
+			sqrt(dLocal.Y() * dLocal.Y() + dLocal.Z() * dLocal.Z()),
+			sqrt(dLocal.Z() * dLocal.Z() + dLocal.X() * dLocal.X()),
+			sqrt(dLocal.X() * dLocal.X() + dLocal.Y() * dLocal.Y())
+		};
+		Float axisProb[3] = { 0.25, 0.5, 0.25 };
+		Float chProb = Float(1) / 3;
+
+		Float pdf = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			for (int ch = 0; ch < 3; ++ch) {
+				pdf += PdfSr(ch, rProj[axis]) * fabs(nLocal[axis]) * chProb * axisProb[axis];
+			}
+		}
+
+		return pdf;
+	}
+
+	BssrdfTable::BssrdfTable(int nAlbedoSamples, int nRadiusSamples)
+		:nAlbedoSamples(nAlbedoSamples), nRadiusSamples(nRadiusSamples)
+		, albedoSamples(nAlbedoSamples), radiusSamples(nRadiusSamples)
+		, profile(nAlbedoSamples * nRadiusSamples), albedoEff(nAlbedoSamples)
+		, profileCdf(nAlbedoSamples * nRadiusSamples) {
+
+	}
+
+	//radius samples grow exponentially, albedo samples are denser near 1
+	//where the profile changes quickly
+	void BssrdfTable::ComputeBeamDiffusion(Float g, Float eta) {
+		radiusSamples[0] = 0;
+		radiusSamples[1] = 2.5e-3;
+		for (int i = 2; i < nRadiusSamples; ++i) {
+			radiusSamples[i] = radiusSamples[i - 1] * 1.2;
+		}
+
+		for (int i = 0; i < nAlbedoSamples; ++i) {
+			albedoSamples[i] = (1 - exp(-8 * i / Float(nAlbedoSamples - 1))) / (1 - exp(-8));
+		}
+
+		//each albedo is independent
+		Parallel::ParallelFor([&](int i) {
+			Float albedo = albedoSamples[i];
+			for (int j = 0; j < nRadiusSamples; ++j) {
+				Float r = radiusSamples[j];
+				profile[i * nRadiusSamples + j] = 2 * PI * r *
+					(BeamDiffusionSS(albedo, 1 - albedo, g, eta, r) +
+					BeamDiffusionMS(albedo, 1 - albedo, g, eta, r));
+			}
+
+			albedoEff[i] = IntegrateCatmullRom(nRadiusSamples, &radiusSamples[0],
+				&profile[i * nRadiusSamples], &profileCdf[i * nRadiusSamples]);
+			}, nAlbedoSamples);
+	}
+
+	//multiple scattering of photon beam diffusion, the beam is
+	//importance sampled by exponential falloff of reduced extinction
+	Float BeamDiffusionMS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r) {
+		const int nSamples = 100;
+		Float eD = 0;
+		Float sigmaSPrime = sigmaS * (1 - g);
+		Float sigmaTPrime = sigmaA + sigmaSPrime;
+		Float albedoPrime = sigmaSPrime / sigmaTPrime;
+		Float dG = (2 * sigmaA + sigmaSPrime) / (3 * sigmaTPrime * sigmaTPrime);
+		Float sigmaTr = sqrt(sigmaA / dG);
+		Float fm1 = FresnelMoment1(eta), fm2 = FresnelMoment2(eta);
+		Float ze = -2 * dG * (1 + 3 * fm2) / (1 - 2 * fm1);
+		Float cPhi = 0.25 * (1 - 2 * fm1), cE = 0.5 * (1 - 3 * fm2);
+
+		for (int i = 0; i < nSamples; ++i) {
+			Float zr = -log(1 - (i + 0.5) / nSamples) / sigmaTPrime;
+			Float zv = -zr + 2 * ze;
+			Float dr = sqrt(r * r + zr * zr);
+			Float dv = sqrt(r * r + zv * zv);
+			Float trdr = sigmaTr * dr;
+			Float trdv = sigmaTr * dv;
+			Float phiD = INV4PI / dG * (exp(-trdr) / dr - exp(-trdv) / dv);
+			Float eDn = INV4PI * (zr * (1 + trdr) * exp(-trdr) / (dr * dr * dr) -
+				zv * (1 + trdv) * exp(-trdv) / (dv * dv * dv));
+
+			Float E = phiD * cPhi + eDn * cE;
+			//corrects an overestimation that can occur when r is small and the light source is close to
+			//the surface
+			Float kappa = 1 - exp(-2 * sigmaTPrime * (dr + zr));
+			//first albedoPrime factor in the scale is needed due to the ratio of the importance sampling
+			//weight of the sampling strategy.
+			//second albedoPrime factor accounts for the additional scattering event in Grosjean's nonclassical
+			//monopole
+			eD += kappa * albedoPrime * albedoPrime * E;
+		}
+
+		eD /= nSamples;
+		return eD;
+	}
+
+	//single scattering, only light refracted along the beam that reaches the
+	//exit point without total internal reflection contributes
+	Float BeamDiffusionSS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r) {
+		const int nSamples = 100;
+		Float sigmaT = sigmaA + sigmaS;
+		Float albedo = sigmaS / sigmaT;
+		Float tCrit = r * sqrt(eta * eta - 1);
+		Float eSS = 0;
+
+		for (int i = 0; i < nSamples; ++i) {
+			Float ti = tCrit - log(1 - (i + 0.5) / nSamples) / sigmaT;
+			Float d = sqrt(r * r + ti * ti);
+			Float cost = ti / d;
+			eSS += albedo * exp(-sigmaT * (d + tCrit)) / (d * d) * PhaseHG(cost, g) *
+				(1 - FrDielectric(-cost, 1, eta)) * fabs(cost);
+		}
+
+		eSS /= nSamples;
+		return eSS;
+	}
+
+	POL_REGISTER_CLASS(TabulatedBssrdf, "subsurface");
+
+	TabulatedBssrdf::TabulatedBssrdf(const PropSets& props, Scene& scene)
+		:SeparableBssrdf(props, scene), table(100, 64) {
+		Float scale = props.GetFloat("scale", 1);
+		Vector3f sigmaA = props.GetVector3f("sigmaA", Vector3f(0.0011, 0.0024, 0.014)) * scale;
+		Vector3f sigmaS = props.GetVector3f("sigmaS", Vector3f(2.55, 3.21, 3.77)) * scale;
+		g = props.GetFloat("g", 0);
+
+		sigmaT = sigmaA + sigmaS;
+		albedo = Vector3f::Zero();
+		for (int ch = 0; ch < 3; ++ch) {
+			if (sigmaT[ch] != 0) albedo[ch] = sigmaS[ch] / sigmaT[ch];
+		}
+
+		table.ComputeBeamDiffusion(g, eta);
+	}
+
+	//profile is tabulated in optical radius with unit sigmaT,
+	//so radius is scaled into optical radius and result is scaled back
+	Vector3f TabulatedBssrdf::Sr(Float r) const {
+		Vector3f ret(0);
+		for (int ch = 0; ch < 3; ++ch) {
+			Float rOptical = r * sigmaT[ch];
+			int albedoOffset, radiusOffset;
+			Float albedoWeights[4], radiusWeights[4];
+			if (!CatmullRomWeights(table.nAlbedoSamples, &table.albedoSamples[0], albedo[ch], &albedoOffset, albedoWeights) ||
+				!CatmullRomWeights(table.nRadiusSamples, &table.radiusSamples[0], rOptical, &radiusOffset, radiusWeights))
+				continue;
+
+			Float sr = 0;
+			for (int i = 0; i < 4; ++i) {
+				if (albedoWeights[i] == 0) continue;
+				for (int j = 0; j < 4; ++j) {
+					if (radiusWeights[j] == 0) continue;
+					sr += albedoWeights[i] * radiusWeights[j] * table.EvalProfile(albedoOffset + i, radiusOffset + j);
+				}
+			}
+
+			//profile is premultiplied by 2*PI*r for sampling
+			if (rOptical != 0) sr /= TWOPI * rOptical;
+			ret[ch] = Max(Float(0), sr * sigmaT[ch] * sigmaT[ch]);
+		}
+
+		return ret;
+	}
+
+	Float TabulatedBssrdf::SampleSr(int ch, Float u) const {
+		if (sigmaT[ch] == 0) return -1;
+
+		return SampleCatmullRom2D(table.nAlbedoSamples, table.nRadiusSamples, &table.albedoSamples[0],
+			&table.radiusSamples[0], &table.profile[0], &table.profileCdf[0], albedo[ch], u, nullptr, nullptr) / sigmaT[ch];
+	}
+
+	Float TabulatedBssrdf::PdfSr(int ch, Float r) const {
+		Float rOptical = r * sigmaT[ch];
+		int albedoOffset, radiusOffset;
+		Float albedoWeights[4], radiusWeights[4];
+		if (!CatmullRomWeights(table.nAlbedoSamples, &table.albedoSamples[0], albedo[ch], &albedoOffset, albedoWeights) ||
+			!CatmullRomWeights(table.nRadiusSamples, &table.radiusSamples[0], rOptical, &radiusOffset, radiusWeights))
+			return 0;
+
+		Float sr = 0, albedoEff = 0;
+		for (int i = 0; i < 4; ++i) {
+			if (albedoWeights[i] == 0) continue;
+			albedoEff += table.albedoEff[albedoOffset + i] * albedoWeights[i];
+			for (int j = 0; j < 4; ++j) {
+				if (radiusWeights[j] == 0) continue;
+				sr += table.EvalProfile(albedoOffset + i, radiusOffset + j) * albedoWeights[i] * radiusWeights[j];
+			}
+		}
+
+		if (rOptical != 0) sr /= TWOPI * rOptical;
+		return Max(Float(0), sr * sigmaT[ch] * sigmaT[ch] / albedoEff);
+	}
+
+	string TabulatedBssrdf::ToString() const {
+		string ret;
+		ret += "TabulatedBssrdf[\n  sigmaT = " + sigmaT.ToString()
+			+ ",\n  albedo = " + albedo.ToString()
+			+ ",\n  eta = " + to_string(eta)
+			+ ",\n  g = " + to_string(g)
+			+ "\n]";
+
+		return ret;
+	}
+
+	SeparableBssrdfAdapter::SeparableBssrdfAdapter(const SeparableBssrdf* bssrdf)
+		:bssrdf(bssrdf) {
+
+	}
+
+	bool SeparableBssrdfAdapter::IsDelta() const {
+		return false;
+	}
+
+	void SeparableBssrdfAdapter::SampleBsdf(const Intersection& isect, const Vector3f& in, const Vector2f& u, Vector3f& out, Vector3f& fr, Float& pdf) const {
+		out = Warp::CosineHemiSphere(u);
+		Fr(isect, in, out, fr, pdf);
+	}
+
+	//radiance is scaled by eta^2 when it leaves the medium
+	void SeparableBssrdfAdapter::Fr(const Intersection& isect, const Vector3f& in, const Vector3f& out, Vector3f& fr, Float& pdf) const {
+		Float cosOut = Frame::CosTheta(out);
+		if (cosOut <= 0) {
+			pdf = 0;
+			fr = Vector3f::Zero();
+			return;
+		}
+
+		Float eta = bssrdf->GetEta();
+		fr = bssrdf->Sw(out) * eta * eta * cosOut;
+		pdf = Warp::CosineHemiSpherePdf(out);
+	}
+
+	string SeparableBssrdfAdapter::ToString() const {
+		return "SeparableBssrdfAdapter[]";
+	}
 }
\ No newline at end of file
@@ -1,15 +1,24 @@
 #pragma once
 
 #include "../pol.h"
+#include "object.h"
 #include "intersection.h"
+#include "bsdf.h"
 
 namespace pol {
 	class Scene;
 	class Sampler;
-	class Bssrdf {
+	class Bssrdf : public PolObject {
 	public:
-		virtual Vector3f SampleS(const Scene& scene, Float u1, const Vector2f& u2, Float& pdf) const = 0;
-		virtual Vector3f EvaluateSubsurface(const Scene& scene, Float u1, const Vector2f& u2) const = 0;
+		Bssrdf();
+		Bssrdf(const PropSets& props, Scene& scene);
+		virtual ~Bssrdf();
+
+		//sample exit point of light entering at isect, the exit point is
+		//returned in probeIsect whose bsdf accounts for the outgoing direction
+		//return spatial term of S(po, wo, pi, wi) and pdf of the exit point
+		virtual Vector3f SampleS(const Scene& scene, const Intersection& isect, Float u1, const Vector2f& u2,
+			Intersection& probeIsect, Float& pdf) const = 0;
 	};
 
 	class JensenBssrdf : public Bssrdf {
@@ -21,7 +30,10 @@ namespace pol {
 	public:
 		JensenBssrdf(const Vector3f& absorb, const Vector3f& scatter, Float eta, Float g);
 
-		virtual Vector3f SampleS(const Scene& scene, Float u1, const Vector2f& u2, Float& pdf) const { return 0; };
+		virtual Vector3f SampleS(const Scene& scene, const Intersection& isect, Float u1, const Vector2f& u2,
+			Intersection& probeIsect, Float& pdf) const { pdf = 0; return 0; };
+
+		virtual string ToString() const;
 
 	private:
 		Vector3f rd(Float d2) const;
@@ -33,43 +45,88 @@ namespace pol {
 		Vector3f multipleScatter(const Scene& scene, const Intersection& isect, const Vector3f& in, const Sampler* sampler) const;
 	};
 
-	/*class SeparableBssrdf : public Bssrdf {
-	private:
+	//separable approximation
+	//      S(po, wo, pi, wi) = (1 - Fr(cos(o))) * Sp(pi) * Sw(wi)
+	//spatial term only depends on distance, Sp(pi) = Sr(|po - pi|)
+	class SeparableBssrdf : public Bssrdf {
+	protected:
 		Float eta;
+		//bsdf of exit point, f = Sw(wi)*cos
+		Bsdf* adapter;
 
 	public:
+		SeparableBssrdf(const PropSets& props, Scene& scene);
+		virtual ~SeparableBssrdf();
+
+		//directional term, w is in local coordinate
 		Vector3f Sw(const Vector3f& w) const;
+		//radial profile
 		virtual Vector3f Sr(Float r) const = 0;
-
-		virtual Vector3f SampleS(const Scene& scene, Float u1, const Vector2f& u2, Float& pdf) const = 0;
+		//sample radius of given channel, return negative if failed
+		virtual Float SampleSr(int ch, Float u) const = 0;
+		virtual Float PdfSr(int ch, Float r) const = 0;
+
+		//probe segments are sampled along three axes of shading frame,
+		//and all exit points of the object on the segment are candidates
+		virtual Vector3f SampleS(const Scene& scene, const Intersection& isect, Float u1, const Vector2f& u2,
+			Intersection& probeIsect, Float& pdf) const;
+		//pdf of exit point combined over axes and channels
+		Float PdfSp(const Intersection& isect, const Intersection& probeIsect) const;
+
+		Float GetEta() const { return eta; }
 	};
 
+	//radial profile of photon beam diffusion tabulated over single scattering albedo
+	//and optical radius, in unit of mean free path so that it is independent of sigmaT
 	struct BssrdfTable {
 		int nAlbedoSamples, nRadiusSamples;
 		vector<Float> albedoSamples, radiusSamples;
 		vector<Float> profile;
+		//effective albedo, integral of profile over plane
 		vector<Float> albedoEff;
 		vector<Float> profileCdf;
 
-		BssrdfTable(int nRhoSamples, int nRadiusSamples);
-		inline Float EvalProfile(int rhoIndex, int radiusIndex) const {
-			return profile[rhoIndex * nRadiusSamples + radiusIndex];
+		BssrdfTable(int nAlbedoSamples, int nRadiusSamples);
+		__forceinline Float EvalProfile(int albedoIndex, int radiusIndex) const {
+			return profile[albedoIndex * nRadiusSamples + radiusIndex];
 		}
 
-		Float BeamDiffusionMS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r);
-		Float BeamDiffusionSS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r);
-
-		void ComputeBeamDiffusionBssrdf(Float g, Float eta);
+		void ComputeBeamDiffusion(Float g, Float eta);
 	};
 
+	Float BeamDiffusionMS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r);
+	Float BeamDiffusionSS(Float sigmaS, Float sigmaA, Float g, Float eta, Float r);
+
+	//table is built once per material, sampling and evaluation
+	//are interpolation of table with catmull-rom spline
 	class TabulatedBssrdf : public SeparableBssrdf {
 	private:
-		const BssrdfTable table;
+		BssrdfTable table;
 		Vector3f sigmaT, albedo;
+		Float g;
 
 	public:
-		TabulatedBssrdf(const Intersection& isect, Float eta, const Vector3f& sigmaA, const Vector3f& sigmaS, const BssrdfTable& table);
+		TabulatedBssrdf(const PropSets& props, Scene& scene);
 
-		virtual Vector3f Sr(Float r) const = 0;
-	};*/
+		virtual Vector3f Sr(Float r) const;
+		virtual Float SampleSr(int ch, Float u) const;
+		virtual Float PdfSr(int ch, Float r) const;
+
+		virtual string ToString() const;
+	};
+
+	//bsdf at exit point of subsurface scattering, outgoing direction is on the side of normal
+	class SeparableBssrdfAdapter : public Bsdf {
+	private:
+		const SeparableBssrdf* bssrdf;
+
+	public:
+		SeparableBssrdfAdapter(const SeparableBssrdf* bssrdf);
+
+		virtual bool IsDelta() const;
+		virtual void SampleBsdf(const Intersection& isect, const Vector3f& in, const Vector2f& u, Vector3f& out, Vector3f& fr, Float& pdf) const;
+		virtual void Fr(const Intersection& isect, const Vector3f& in, const Vector3f& out, Vector3f& fr, Float& pdf) const;
+
+		virtual string ToString() const;
+	};
 }
\ No newline at end of file
@@ -20,7 +20,12 @@ namespace pol {
 		string tonemap = props.GetString("tonemap", "gamma");
 		string output = props.GetString("output");
 		Float scale = props.GetFloat("scale", 1);
-		film = new Film(output, Vector2i(xRes, yRes), tonemap, scale);
+		bool aov = props.GetBool("aov", false);
+		bool denoise = props.GetBool("denoise", false);
+		int denoiseRadius = props.GetInt("denoiseRadius", 5);
+		bool stream = props.GetBool("streamOutput", false);
+		film = new Film(output, Vector2i(xRes, yRes), tonemap, scale, aov, denoise, denoiseRadius, stream);
+		film->progressiveOutput = props.GetBool("progressiveOutput", false);
 
 		scene.SetCamera(this);
 	}
@@ -1,63 +1,103 @@
 #include "catmullrom.h"
 
 namespace pol {
-	int FindInterval(int size, const Float* nodes, Float x) {
-		for (int i = 0; i < size - 1; ++i) {
-			if (x > nodes[i] && x < nodes[i + 1]) return i;
-		}
-
-		return -1;
+	//find the last index i in [0, size - 2] that pred(i) is true,
+	//pred must be true for a prefix of indices
+	template<typename Predicate>
+	static int FindInterval(int size, const Predicate& pred) {
+		int first = 0, len = size;
+		while (len > 0) {
+			int half = len >> 1, middle = first + half;
+			if (pred(middle)) {
+				first = middle + 1;
+				len -= half + 1;
+			}
+			else {
+				len = half;
+			}
+		}
+
+		return Min(Max(first - 1, 0), size - 2);
 	}
 
-	Float CatmullRom(int size, const Float* nodes, const Float* values, Float x) {
-		if (x < nodes[0] || x > nodes[size - 1]) return 0;
-
-		int idx = FindInterval(size, nodes, x);
-		Float x0 = nodes[idx], x1 = nodes[idx + 1];
-		Float f0 = values[idx], f1 = values[idx + 1];
-		Float width = x1 - x0;
-		Float d0, d1;
-		if (idx > 0) {
-			d0 = (f1 - values[idx - 1]) / (x1 - nodes[idx - 1]);
+	//invert the cubic F(t) with newton-bisection, F(t) and f(t) are integral
+	//and value of hermite spline on [0, 1] with end points f0, f1 and derivatives d0, d1
+	static Float InvertSegment(Float f0, Float f1, Float d0, Float d1, Float u, Float& fhat) {
+		Float t;
+		if (f0 != f1) {
+			t = (f0 - sqrt(Max(Float(0), f0 * f0 + 2 * u * (f1 - f0)))) / (f0 - f1);
 		}
 		else {
-			d0 = (f1 - f0) / width;
+			t = u / f0;
 		}
 
-		if (idx < size - 2) {
-			d1 = (values[idx + 1] - f0) / (nodes[idx + 1] - x0);
+		Float a = 0, b = 1, Fhat;
+		while (true) {
+			if (!(t >= a && t <= b))
+				t = 0.5 * (a + b);
+
+			Fhat = t * (f0 + t * (0.5 * d0 + t * ((1.f / 3.f) * (-2 * d0 - d1) + f1 - f0 + t * (0.25 * (d0 + d1) + 0.5 * (f0 - f1)))));
+			fhat = f0 + t * (d0 + t * (-2 * d0 - d1 + 3 * (f1 - f0) + t * (d0 + d1 + 2 * (f0 - f1))));
+
+			if (abs(Fhat - u) < 1e-6f || b - a < 1e-6f)
+				break;
+
+			if (Fhat - u < 0) a = t;
+			else b = t;
+
+			t -= (Fhat - u) / fhat;
 		}
-		else {
-			d1 = (f1 - f0) / width;
+
+		return t;
+	}
+
+	Float CatmullRom(int size, const Float* nodes, const Float* values, Float x) {
+		int offset;
+		Float weights[4];
+		if (!CatmullRomWeights(size, nodes, x, &offset, weights)) return 0;
+
+		Float ret = 0;
+		for (int i = 0; i < 4; ++i) {
+			if (weights[i] != 0) ret += weights[i] * values[offset + i];
 		}
 
-		Float t = (x - x0) / (x1 - x0), t2 = t * t, t3 = t2 * t;
-		return (2 * t3 - 3 * t2 + 1) * f0 + (-2 * t3 + 3 * t2) * f1 + 
-			(t3 - 2 * t2 + t) * d0 + (t3 - t2) * d1;
+		return ret;
 	}
 
 	bool CatmullRomWeights(int size, const Float* nodes, Float x, int* offset, Float* weights) {
 		if (!(x >= nodes[0] && x <= nodes[size - 1])) return false;
 
-		int idx = FindInterval(size, nodes, x);
+		int idx = FindInterval(size, [&](int i) { return nodes[i] <= x; });
 		*offset = idx - 1;
 
 		Float x0 = nodes[idx], x1 = nodes[idx + 1];
 		Float t = (x - x0) / (x1 - x0), t2 = t * t, t3 = t2 * t;
-		weights[0] = 2 * t3 - 3 * t2 + 1;
-		weights[1] = -2 * t3 + 3 * t2;
+		weights[1] = 2 * t3 - 3 * t2 + 1;
+		weights[2] = -2 * t3 + 3 * t2;
 
+		//derivative terms are distributed to neighbor values,
+		//one-sided difference is used at boundary
 		if (idx > 0) {
-			weights[2] = t3 - 2 * t2 + t;
+			Float w0 = (t3 - 2 * t2 + t) * (x1 - x0) / (x1 - nodes[idx - 1]);
+			weights[0] = -w0;
+			weights[2] += w0;
 		}
 		else {
-			weights[2] = 0;
+			Float w0 = t3 - 2 * t2 + t;
+			weights[0] = 0;
+			weights[1] -= w0;
+			weights[2] += w0;
 		}
 
-		if (idx < size - 2) {
-			weights[3] = t3 - t2;
+		if (idx + 2 < size) {
+			Float w3 = (t3 - t2) * (x1 - x0) / (nodes[idx + 2] - x0);
+			weights[1] -= w3;
+			weights[3] = w3;
 		}
 		else {
+			Float w3 = t3 - t2;
+			weights[1] -= w3;
+			weights[2] += w3;
 			weights[3] = 0;
 		}
 
@@ -66,64 +106,115 @@ namespace pol {
 
 	Float SampleCatmullRom(int n, const Float* x, const Float* f, const Float* F,
 		Float u, Float* fval, Float* pdf) {
-		Float u1 = u * F[n - 1];
-		int idx = FindInterval(n, F, u1);
+		u = u * F[n - 1];
+		int idx = FindInterval(n, [&](int i) { return F[i] <= u; });
 
 		Float x0 = x[idx], x1 = x[idx + 1];
 		Float f0 = f[idx], f1 = f[idx + 1];
 		Float width = x1 - x0;
 
+		//derivatives are scaled to segment parameterized on [0, 1]
 		Float d0, d1;
 		if (idx > 0) {
-			d0 = (f1 - f[idx - 1]) / (x1 - x[idx - 1]);
+			d0 = width * (f1 - f[idx - 1]) / (x1 - x[idx - 1]);
 		}
 		else {
-			d0 = (f1 - f0) / width;
+			d0 = f1 - f0;
 		}
 
-		if (idx < n - 2) {
-			d1 = (f[idx + 2] - f0) / (x[idx + 2] - x0);
+		if (idx + 2 < n) {
+			d1 = width * (f[idx + 2] - f0) / (x[idx + 2] - x0);
 		}
 		else {
-			d1 = (f1 - f0) / width;
+			d1 = f1 - f0;
 		}
 
-		Float u2 = u1 - F[idx];
+		u = (u - F[idx]) / width;
+		Float fhat;
+		Float t = InvertSegment(f0, f1, d0, d1, u, fhat);
 
-		Float t;
-		if (f0 != f1) {
-			t = (f0 - sqrt(Max(Float(0), f0 * f0 + 2 * u2 * (f1 - f0)))) / (f0 - f1);
+		if (fval) *fval = fhat;
+		if (pdf) *pdf = fhat / F[n - 1];
+		return x0 + width * t;
+	}
+
+	Float SampleCatmullRom2D(int size1, int size2, const Float* nodes1,
+		const Float* nodes2, const Float* values,
+		const Float* cdf, Float alpha, Float u, Float* fval,
+		Float* pdf) {
+		int offset;
+		Float weights[4];
+		if (!CatmullRomWeights(size1, nodes1, alpha, &offset, weights)) return 0;
+
+		//spline of second dimension is interpolated from rows of first dimension
+		auto interpolate = [&](const Float* array, int idx) {
+			Float value = 0;
+			for (int i = 0; i < 4; ++i) {
+				if (weights[i] != 0)
+					value += array[(offset + i) * size2 + idx] * weights[i];
+			}
+
+			return value;
+		};
+
+		Float maximum = interpolate(cdf, size2 - 1);
+		u *= maximum;
+		int idx = FindInterval(size2, [&](int i) { return interpolate(cdf, i) <= u; });
+
+		Float f0 = interpolate(values, idx), f1 = interpolate(values, idx + 1);
+		Float x0 = nodes2[idx], x1 = nodes2[idx + 1];
+		Float width = x1 - x0;
+		Float d0, d1;
+		if (idx > 0) {
+			d0 = width * (f1 - interpolate(values, idx - 1)) / (x1 - nodes2[idx - 1]);
 		}
 		else {
-			t = u2 / f0;
+			d0 = f1 - f0;
 		}
 
-		Float a = 0, b = 1, Fhat, fhat;
-		while (true) {
-			if (!(t >= a && t <= b))
-				t = 0.5 * (a + b);
-			
-			Fhat = t * (f0 + t * (0.5 * d0 + t * ((1.f / 3.f) * (-2 * d0 - d1) + f1 - f0 + t * (0.25 * (d0 + d1) + 0.5 * (f0 - f1)))));
-			fhat = f0 + t * (d0 + t * (-2 * d0 - d1 + 3 * (f1 - f0) + t * (d0 + d1 + 2 * (f0 - f1))));
-			
-			if (abs(Fhat - u2) < 1e-6f || b - a < 1e-6f)
-				break;
-
-			if (Fhat - u2 < 0) a = t;
-			else b = t;
-
-			t -= Fhat / fhat;
+		if (idx + 2 < size2) {
+			d1 = width * (interpolate(values, idx + 2) - f0) / (nodes2[idx + 2] - x0);
+		}
+		else {
+			d1 = f1 - f0;
 		}
 
+		u = (u - interpolate(cdf, idx)) / width;
+		Float fhat;
+		Float t = InvertSegment(f0, f1, d0, d1, u, fhat);
+
 		if (fval) *fval = fhat;
-		if (pdf) *pdf = fhat / F[n - 1];
+		if (pdf) *pdf = fhat / maximum;
 		return x0 + width * t;
 	}
 
-	Float SampleCatmullRom2D(int size1, int size2, const Float* nodes1,
-		const Float* nodes2, const Float* values,
-		const Float* cdf, Float alpha, Float u, Float* fval,
-		Float* pdf) {
-		return 0;
+	Float IntegrateCatmullRom(int n, const Float* x, const Float* values, Float* cdf) {
+		Float sum = 0;
+		cdf[0] = 0;
+		for (int i = 0; i < n - 1; ++i) {
+			Float x0 = x[i], x1 = x[i + 1];
+			Float f0 = values[i], f1 = values[i + 1];
+			Float width = x1 - x0;
+			Float d0, d1;
+			if (i > 0) {
+				d0 = width * (f1 - values[i - 1]) / (x1 - x[i - 1]);
+			}
+			else {
+				d0 = f1 - f0;
+			}
+
+			if (i + 2 < n) {
+				d1 = width * (values[i + 2] - f0) / (x[i + 2] - x0);
+			}
+			else {
+				d1 = f1 - f0;
+			}
+
+			//integral of hermite segment
+			sum += ((d0 - d1) * (1.f / 12.f) + (f0 + f1) * 0.5) * width;
+			cdf[i + 1] = sum;
+		}
+
+		return sum;
 	}
 }
\ No newline at end of file
@@ -3,12 +3,20 @@
 #include "../pol.h"
 
 namespace pol {
+	//catmull-rom spline through (nodes[i], values[i]), derivatives at
+	//nodes are estimated by finite differences of neighbors
 	Float CatmullRom(int size, const Float* nodes, const Float* value, Float x);
+	//weights of 4 values starting from offset, whose weighted sum is the
+	//spline at x. weights outside range are 0
 	bool CatmullRomWeights(int size, const Float* nodes, Float x, int* offset, Float* weights);
+	//sample spline proportional to f with its integral F from IntegrateCatmullRom
 	Float SampleCatmullRom(int n, const Float* x, const Float* f, const Float* F,
 		Float u, Float* fval, Float* pdf);
+	//sample second dimension of a 2D spline, first dimension is fixed to alpha
 	Float SampleCatmullRom2D(int size1, int size2, const Float* nodes1,
 		const Float* nodes2, const Float* values,
 		const Float* cdf, Float alpha, Float u, Float* fval,
 		Float* pdf);
+	//integrate spline, cdf[i] is integral from x[0] to x[i]
+	Float IntegrateCatmullRom(int n, const Float* x, const Float* values, Float* cdf);
 }
\ No newline at end of file
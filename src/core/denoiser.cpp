@@ -0,0 +1,100 @@
+#include "denoiser.h"
+#include "parallel.h"
+
+namespace pol {
+	Denoiser::Denoiser(int radius)
+		:radius(Max(radius, 1)) {
+		sigmaSpatial = Float(radius) * 0.5;
+		sigmaColor = 0.6;
+		sigmaAlbedo = 0.1;
+		sigmaNormal = 0.3;
+		sigmaDepth = 0.05;
+	}
+
+	void Denoiser::Denoise(const Vector2i& res, const vector<Vector3f>& color, const vector<Vector3f>& albedo,
+		const vector<Vector3f>& normal, const vector<Float>& depth, vector<Vector3f>& output) const {
+		int nPixels = res.x * res.y;
+		bool hasAlbedo = albedo.size() == nPixels;
+		bool hasNormal = normal.size() == nPixels;
+		bool hasDepth = depth.size() == nPixels;
+
+		//demodulate albedo, channel without albedo keeps its color
+		const Float minAlbedo = 1e-3;
+		vector<Vector3f> factor(nPixels, Vector3f::One());
+		vector<Vector3f> irradiance(nPixels);
+		Parallel::ParallelFor([&](int y) {
+			for (int x = 0; x < res.x; ++x) {
+				int p = y * res.x + x;
+				if (hasAlbedo) {
+					for (int c = 0; c < 3; ++c) {
+						if (albedo[p][c] > minAlbedo) factor[p][c] = albedo[p][c];
+					}
+				}
+
+				irradiance[p] = color[p] / factor[p];
+			}
+			}, res.y, 16);
+
+		//3x3 box prefilter, color weight is computed on it so that
+		//weights are not driven by noise of single samples
+		vector<Vector3f> guide(nPixels);
+		Parallel::ParallelFor([&](int y) {
+			for (int x = 0; x < res.x; ++x) {
+				Vector3f sum(0);
+				int count = 0;
+				for (int j = Max(y - 1, 0); j <= Min(y + 1, res.y - 1); ++j) {
+					for (int i = Max(x - 1, 0); i <= Min(x + 1, res.x - 1); ++i) {
+						sum += irradiance[j * res.x + i];
+						count++;
+					}
+				}
+
+				guide[y * res.x + x] = sum / Float(count);
+			}
+			}, res.y, 16);
+
+		//spatial weights are same for every pixel
+		int width = 2 * radius + 1;
+		vector<Float> spatial(width * width);
+		for (int j = -radius; j <= radius; ++j) {
+			for (int i = -radius; i <= radius; ++i) {
+				spatial[(j + radius) * width + i + radius] = exp(-(i * i + j * j) / (2 * sigmaSpatial * sigmaSpatial));
+			}
+		}
+
+		Float invColor = 1 / (2 * sigmaColor * sigmaColor);
+		Float invAlbedo = 1 / (2 * sigmaAlbedo * sigmaAlbedo);
+		Float invNormal = 1 / (2 * sigmaNormal * sigmaNormal);
+		Float invDepth = 1 / (2 * sigmaDepth * sigmaDepth);
+		output.resize(nPixels);
+		Parallel::ParallelFor([&](int y) {
+			for (int x = 0; x < res.x; ++x) {
+				int p = y * res.x + x;
+				const Vector3f& gp = guide[p];
+				Vector3f sum(0);
+				Float weightSum = 0;
+				for (int j = Max(y - radius, 0); j <= Min(y + radius, res.y - 1); ++j) {
+					for (int i = Max(x - radius, 0); i <= Min(x + radius, res.x - 1); ++i) {
+						int q = j * res.x + i;
+						//color distance relative to brightness
+						const Vector3f& gq = guide[q];
+						Float e = (gp - gq).LengthSquare() / (Float(1e-2) + gp.LengthSquare() + gq.LengthSquare()) * invColor;
+						if (hasAlbedo) e += (albedo[p] - albedo[q]).LengthSquare() * invAlbedo;
+						if (hasNormal) e += (normal[p] - normal[q]).LengthSquare() * invNormal;
+						if (hasDepth) {
+							Float d = (depth[p] - depth[q]) / Max(depth[p], Float(1e-4));
+							e += d * d * invDepth;
+						}
+
+						Float w = spatial[(j - y + radius) * width + i - x + radius] * exp(-e);
+						sum += irradiance[q] * w;
+						weightSum += w;
+					}
+				}
+
+				//center pixel always has positive weight
+				output[p] = sum / weightSum * factor[p];
+			}
+			}, res.y, 4);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../pol.h"
+
+namespace pol {
+	//joint cross-bilateral denoiser guided by albedo, shading normal and depth
+	//color is divided by albedo before filtering so that texture details are
+	//kept, then weights of neighbours fall off with distance, difference of
+	//features and difference of prefiltered color
+	class Denoiser {
+	private:
+		//half width of filter window
+		int radius;
+		Float sigmaSpatial;
+		Float sigmaColor;
+		Float sigmaAlbedo;
+		Float sigmaNormal;
+		//relative to depth of center pixel
+		Float sigmaDepth;
+
+	public:
+		Denoiser(int radius = 5);
+
+		//aov buffers can be empty, then corresponding feature is ignored
+		void Denoise(const Vector2i& res, const vector<Vector3f>& color, const vector<Vector3f>& albedo,
+			const vector<Vector3f>& normal, const vector<Float>& depth, vector<Vector3f>& output) const;
+	};
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "directory.h"
+#include <sys/stat.h>
 
 namespace pol {
 	string Directory::base;
@@ -6,4 +7,13 @@ namespace pol {
 	string Directory::GetFullPath(const string& p) {
 		return base + p;
 	}
+
+	bool Directory::GetFileStamp(const string& p, int64_t& size, int64_t& time) {
+		struct stat st;
+		if (stat(p.c_str(), &st) != 0) return false;
+
+		size = st.st_size;
+		time = st.st_mtime;
+		return true;
+	}
 }
\ No newline at end of file
@@ -9,5 +9,7 @@ namespace pol {
 
 	public:
 		static string GetFullPath(const string& p);
+		//size and last modified time of file, false if file does not exist
+		static bool GetFileStamp(const string& p, int64_t& size, int64_t& time);
 	};
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "distribution.h"
+#include "parallel.h"
 
 namespace pol {
 	Distribution1D::Distribution1D() {
@@ -24,6 +25,8 @@ namespace pol {
 			for (int i = 1; i < n + 1; ++i)
 				cdf[i] /= funcInt;
 		}
+
+		buildAliasTable();
 	}
 
 	int Distribution1D::Count() const {
@@ -59,6 +62,41 @@ namespace pol {
 		return cdf[idx + 1] - cdf[idx];
 	}
 
+	Float Distribution1D::SampleAliasContinuous(Float u, Float& pdf, int& ret) const {
+		Float du;
+		int idx = sampleAlias(u, du);
+		ret = idx;
+		pdf = DiscretePdf(idx) * Count();
+
+		return (idx + du) / Count();
+	}
+
+	int Distribution1D::SampleAliasDiscrete(Float u) const {
+		Float du;
+		return sampleAlias(u, du);
+	}
+
+	void Distribution1D::Write(ostream& out) const {
+		int n = Count();
+		out.write((const char*)&n, sizeof(int));
+		out.write((const char*)&funcInt, sizeof(Float));
+		out.write((const char*)&cdf[0], sizeof(Float) * cdf.size());
+		out.write((const char*)&aliasTable[0], sizeof(AliasBin) * aliasTable.size());
+	}
+
+	bool Distribution1D::Read(istream& in, int n) {
+		int count = 0;
+		in.read((char*)&count, sizeof(int));
+		if (!in || n <= 0 || count != n) return false;
+
+		cdf.resize(n + 1);
+		aliasTable.resize(n);
+		in.read((char*)&funcInt, sizeof(Float));
+		in.read((char*)&cdf[0], sizeof(Float) * cdf.size());
+		in.read((char*)&aliasTable[0], sizeof(AliasBin) * aliasTable.size());
+		return bool(in);
+	}
+
 	int Distribution1D::findInterval(Float u) const {
 		//binary search
 		int s = 0;
@@ -74,15 +112,62 @@ namespace pol {
 		}
 	}
 
+	//vose's method, probabilities scaled by n are split into bins below and above 1,
+	//each small bin is filled up by a large one which becomes its alias
+	void Distribution1D::buildAliasTable() {
+		int n = Count();
+		aliasTable.resize(n);
+		vector<double> scaled(n);
+		vector<int> small, large;
+		for (int i = 0; i < n; ++i) {
+			scaled[i] = double(DiscretePdf(i)) * n;
+			if (scaled[i] < 1) small.push_back(i);
+			else large.push_back(i);
+		}
+
+		while (!small.empty() && !large.empty()) {
+			int s = small.back();
+			small.pop_back();
+			int l = large.back();
+			large.pop_back();
+
+			aliasTable[s].q = Float(scaled[s]);
+			aliasTable[s].alias = l;
+			scaled[l] = (scaled[l] + scaled[s]) - 1;
+			if (scaled[l] < 1) small.push_back(l);
+			else large.push_back(l);
+		}
+
+		//remaining bins are full up to round-off error
+		for (int i : large) aliasTable[i] = { 1, i };
+		for (int i : small) aliasTable[i] = { 1, i };
+	}
+
+	int Distribution1D::sampleAlias(Float u, Float& remapped) const {
+		int n = Count();
+		Float un = u * n;
+		int idx = Min(int(un), n - 1);
+		Float up = Min(un - idx, Float(0.99999994));
+		const AliasBin& bin = aliasTable[idx];
+		if (up < bin.q) {
+			remapped = up / bin.q;
+			return idx;
+		}
+
+		remapped = Min((up - bin.q) / (1 - bin.q), Float(0.99999994));
+		return bin.alias;
+	}
+
 	Distribution2D::Distribution2D() {
 
 	}
 
 	Distribution2D::Distribution2D(const Float f[], int nu, int nv) {
 		conditional.resize(nv);
-		for (int i = 0; i < nv; ++i) {
+		//rows are independent
+		Parallel::ParallelFor([&](int i) {
 			conditional[i] = Distribution1D(&f[i * nu], nu);
-		}
+			}, nv, 16);
 
 		vector<Float> marginalFunc;
 		marginalFunc.resize(nv);
@@ -102,6 +187,37 @@ namespace pol {
 		return Vector2f(p1, p2);
 	}
 
+	Vector2f Distribution2D::SampleAlias(const Vector2f& u, Float& pdf) const {
+		Float pdf1, pdf2;
+		int v;
+		Float p2 = marginal.SampleAliasContinuous(u.y, pdf2, v);
+		Float p1 = conditional[v].SampleAliasContinuous(u.x, pdf1, v);
+
+		pdf = pdf1 * pdf2;
+		return Vector2f(p1, p2);
+	}
+
+	void Distribution2D::Write(ostream& out) const {
+		int nv = conditional.size();
+		out.write((const char*)&nv, sizeof(int));
+		marginal.Write(out);
+		for (const Distribution1D& d : conditional) d.Write(out);
+	}
+
+	bool Distribution2D::Read(istream& in, int nu, int nv) {
+		int count = 0;
+		in.read((char*)&count, sizeof(int));
+		if (!in || nv <= 0 || count != nv) return false;
+
+		conditional.resize(nv);
+		if (!marginal.Read(in, nv)) return false;
+		for (Distribution1D& d : conditional) {
+			if (!d.Read(in, nu)) return false;
+		}
+
+		return true;
+	}
+
 	Float Distribution2D::Pdf(const Vector2f& uv) const {
 		Float count = conditional[0].Count();
 		int iu = Clamp(uv.x * count, Float(0), Float(count - 1));
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "../pol.h"
+#include <iostream>
 
 namespace pol {
 	class Distribution1D {
 	private:
+		//bin of alias table, bin i is chosen with probability q,
+		//otherwise alias is chosen
+		struct AliasBin {
+			Float q;
+			int alias;
+		};
+
 		vector<Float> cdf;
+		vector<AliasBin> aliasTable;
 		//integration of function
 		Float funcInt;
 
@@ -19,9 +28,21 @@ namespace pol {
 		Float SampleContinuous(Float u, Float& pdf, int& ret) const;
 		int SampleDiscrete(Float u) const;
 		Float DiscretePdf(int idx) const;
+		//O(1) sampling with alias table, the distribution is the same as
+		//sampling with cdf but the mapping of u is not monotonic
+		Float SampleAliasContinuous(Float u, Float& pdf, int& ret) const;
+		int SampleAliasDiscrete(Float u) const;
+
+		//binary serialization of built tables
+		void Write(ostream& out) const;
+		//fail if stored count is not n
+		bool Read(istream& in, int n);
 
 	private:
 		int findInterval(Float u) const;
+		void buildAliasTable();
+		//choose bin, u is remapped to [0, 1) within the bin
+		int sampleAlias(Float u, Float& remapped) const;
 	};
 
 	class Distribution2D {
@@ -34,6 +55,11 @@ namespace pol {
 		Distribution2D(const Float f[], int nu, int nv);
 
 		Vector2f SampleContinuous(const Vector2f& u, Float& pdf) const;
+		Vector2f SampleAlias(const Vector2f& u, Float& pdf) const;
 		Float Pdf(const Vector2f& uv) const;
+
+		void Write(ostream& out) const;
+		//fail if stored size is not nu * nv
+		bool Read(istream& in, int nu, int nv);
 	};
 }
\ No newline at end of file
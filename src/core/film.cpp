@@ -1,19 +1,62 @@
 #include "film.h"
 #include "imageio.h"
 #include "directory.h"
+#include "denoiser.h"
+#include "parallel.h"
 
 namespace pol {
-	Film::Film(const string& filename, const Vector2i& res, string tonemap, Float scale)
-		:filename(filename), res(res), tonemap(tonemap), scale(scale) {
+	Film::Film(const string& filename, const Vector2i& res, string tonemap, Float scale,
+		bool aov, bool denoise, int denoiseRadius, bool stream)
+		:filename(filename), res(res), tonemap(tonemap), scale(scale)
+		, aov(aov), denoise(denoise), denoiseRadius(denoiseRadius), stream(stream) {
+		if (tonemap == "gamma") tonemapMode = Tonemap::E_GAMMA;
+		else tonemapMode = Tonemap::E_FILMIC;
+
+		locks = nullptr;
+		writer = nullptr;
+		streamWriter = nullptr;
+		streamWeight = 1;
+		progressiveOutput = false;
+		if (stream) {
+			//filter of denoiser needs whole image
+			if (HasAov()) fprintf(stderr, "aov and denoise are disabled in stream mode\n");
+			this->aov = this->denoise = false;
+			return;
+		}
+
 		//resize image buffer
 		image.resize(res.x * res.y);
+		if (HasAov()) {
+			albedo.resize(res.x * res.y, Vector3f::Zero());
+			normal.resize(res.x * res.y, Vector3f::Zero());
+			depth.resize(res.x * res.y, 0);
+		}
 		locks = new mutex[res.x * res.y];
 	}
 
 	Film::~Film() {
+		//pending snapshots are written before exit
+		POL_SAFE_DELETE(writer);
+		POL_SAFE_DELETE(streamWriter);
+		for (auto& row : streamRows) delete row.second;
 		delete[] locks;
 	}
 
+	void Film::DisableStream() {
+		if (!stream) return;
+
+		stream = false;
+		image.resize(res.x * res.y);
+		locks = new mutex[res.x * res.y];
+	}
+
+	void Film::DisableAov() {
+		aov = denoise = false;
+		vector<Vector3f>().swap(albedo);
+		vector<Vector3f>().swap(normal);
+		vector<Float>().swap(depth);
+	}
+
 	void Film::AddPixel(int p, const Vector3f& c) {
 		POL_ASSERT(p < res.x * res.y);
 
@@ -42,38 +85,260 @@ namespace pol {
 		image[pix] += c;
 	}
 
-	bool Film::WriteImage(Float weight) {
-		for (Vector3f& c : image) {
-			c *= scale * weight;
-			if (tonemap == "gamma") c = gamma(c);
-			else if (tonemap == "filmic") c = filmic(c);
-			else c = filmic(c);
+	void Film::AddBlock(const RenderBlock& rb, const Vector3f* colors) {
+		if (!stream) {
+			for (int j = 0; j < rb.h; ++j) {
+				memcpy(&image[(rb.sy + j) * res.x + rb.sx], &colors[j * rb.w], sizeof(Vector3f) * rb.w);
+			}
+
+			return;
 		}
 
-		bool success = ImageIO::SavePng(Directory::GetFullPath(filename).c_str(), res.x, res.y, image);
-		
-		return success;
+		StreamRow* row;
+		{
+			lock_guard<mutex> lock(streamMutex);
+			auto it = streamRows.find(rb.sy);
+			if (it == streamRows.end()) {
+				row = new StreamRow();
+				row->pixels.resize(rb.h * res.x);
+				row->remaining = rb.h * res.x;
+				streamRows[rb.sy] = row;
+			}
+			else {
+				row = it->second;
+			}
+
+			for (int j = 0; j < rb.h; ++j) {
+				memcpy(&row->pixels[j * res.x + rb.sx], &colors[j * rb.w], sizeof(Vector3f) * rb.w);
+			}
+			row->remaining -= rb.w * rb.h;
+			if (row->remaining > 0) return;
+
+			streamRows.erase(rb.sy);
+		}
+
+		//whole row of blocks is finished, flip to top-down order of exr
+		vector<Vector3f> flipped(row->pixels.size());
+		for (int j = 0; j < rb.h; ++j) {
+			const Vector3f* in = &row->pixels[(rb.h - j - 1) * res.x];
+			Vector3f* out = &flipped[j * res.x];
+			for (int x = 0; x < res.x; ++x) out[x] = in[x] * streamWeight;
+		}
+		delete row;
+
+		streamWriter->WriteRows(res.y - rb.sy - rb.h, rb.h, &flipped[0]);
+	}
+
+	bool Film::BeginStream(Float weight) {
+		string path = Directory::GetFullPath(filename);
+		size_t dot = path.find_last_of('.');
+		string ext = dot == string::npos ? "" : path.substr(dot);
+		for (char& c : ext) c = tolower(c);
+		if (ext != ".exr") {
+			path = (dot == string::npos ? path : path.substr(0, dot)) + ".exr";
+			fprintf(stderr, "stream mode only supports exr, image is saved to [%s]\n", path.c_str());
+		}
+
+		streamWeight = scale * weight;
+		streamWriter = new ExrScanlineWriter();
+		return streamWriter->Open(path.c_str(), res.x, res.y);
+	}
+
+	bool Film::EndStream() {
+		if (!streamRows.empty()) fprintf(stderr, "%d rows of blocks are not finished\n", int(streamRows.size()));
+
+		streamWriter->Close();
+		return streamRows.empty();
+	}
+
+	void Film::AddAov(const Vector2i& p, const Vector3f& a, const Vector3f& n, Float d) {
+		POL_ASSERT(p.x < res.x && p.y < res.y);
+
+		int pix = p.y * res.x + p.x;
+		albedo[pix] += a;
+		normal[pix] += n;
+		depth[pix] += d;
 	}
 
-	Vector3f Film::filmic(const Vector3f& in) const {
-		Vector3f c = in - Vector3f(0.004);
-		c = Max(c, Vector3f(0.f));
-		c = (c * (Float(6.2) * c + Float(0.5))) / (c * (Float(6.2) * c + Float(1.7)) + Float(0.06));
-	
-		return c;
+	bool Film::WriteImage(Float weight) const {
+		//older snapshots must not overwrite this image
+		if (writer) writer->Flush();
+
+		return write(image, albedo, normal, depth, weight);
 	}
 
-	Vector3f Film::gamma(const Vector3f& c) const {
-		auto toSRGB = [](Float value)->Float {
-			if (value < 0.0031308)
-				return 12.92 * value;
-			return 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+	void Film::WriteImageAsync(Float weight) {
+		if (!writer) writer = new ImageWriter();
+
+		struct Snapshot {
+			vector<Vector3f> color, a, n;
+			vector<Float> d;
 		};
+		shared_ptr<Snapshot> snapshot = make_shared<Snapshot>();
+		snapshot->color = image;
+		snapshot->a = albedo;
+		snapshot->n = normal;
+		snapshot->d = depth;
+		writer->Push([this, snapshot, weight]() {
+			write(snapshot->color, snapshot->a, snapshot->n, snapshot->d, weight);
+			});
+	}
+
+	bool Film::write(const vector<Vector3f>& color, const vector<Vector3f>& a, const vector<Vector3f>& n,
+		const vector<Float>& d, Float weight) const {
+		vector<Vector3f> hdr;
+		resolve(color, weight, hdr);
+
+		if (denoise) {
+			//features are averaged over samples before guiding the filter
+			vector<Vector3f> albedoAvg(a.size()), normalAvg(n.size());
+			vector<Float> depthAvg(d.size());
+			for (int i = 0; i < a.size(); ++i) {
+				albedoAvg[i] = a[i] * weight;
+				normalAvg[i] = n[i] * weight;
+				depthAvg[i] = d[i] * weight;
+			}
+
+			vector<Vector3f> filtered;
+			Denoiser(denoiseRadius).Denoise(res, hdr, albedoAvg, normalAvg, depthAvg, filtered);
+			hdr.swap(filtered);
+		}
+
+		if (aov && !writeAov(a, n, d, weight)) return false;
+
+		string path = Directory::GetFullPath(filename);
+		string ext = path.substr(Min(path.find_last_of('.'), path.size()));
+		for (char& c : ext) c = tolower(c);
+		if (ext == ".pfm") {
+			return ImageIO::SavePfm(path.c_str(), res.x, res.y, hdr);
+		}
+		else if (ext == ".exr") {
+			//exr is stored from top row to bottom row
+			vector<Vector3f> flipped(hdr.size());
+			for (int i = 0; i < res.y; ++i) {
+				memcpy(&flipped[i * res.x], &hdr[(res.y - i - 1) * res.x], sizeof(Vector3f) * res.x);
+			}
+
+			return ImageIO::SaveExr(path.c_str(), res.x, res.y, flipped);
+		}
+
+		vector<unsigned char> ldr;
+		encode(hdr, ldr);
+
+		return ImageIO::SavePng(path.c_str(), res.x, res.y, &ldr[0]);
+	}
+
+	void Film::resolve(const vector<Vector3f>& input, Float weight, vector<Vector3f>& output) const {
+		output.resize(input.size());
+		__m128 s = _mm_set1_ps(scale * weight);
+		Parallel::ParallelFor([&](int y) {
+			const Vector3f* in = &input[y * res.x];
+			Vector3f* out = &output[y * res.x];
+			for (int x = 0; x < res.x; ++x) {
+				out[x] = Vector3f(_mm_mul_ps(in[x].m, s));
+			}
+			}, res.y, 32);
+	}
 
-		return Vector3f(toSRGB(c.X()), toSRGB(c.Y()), toSRGB(c.Z()));
+	//linear to srgb 8-bit table indexed by exponent and top 8 bits of mantissa of float,
+	//covering [2^-13, 1], smaller values are all encoded to 0.
+	//error of each bucket is below one unit of 8-bit output
+	static const int SRGBMinExponent = 127 - 13;
+	static const int SRGBTableSize = (13 << 8) + 1;
+
+	static const unsigned char* BuildSRGBTable() {
+		static unsigned char table[SRGBTableSize];
+		for (int i = 0; i < SRGBTableSize; ++i) {
+			//center of bucket
+			uint32_t bits = (uint32_t(i + (SRGBMinExponent << 8)) << 15) | (1 << 14);
+			float v;
+			memcpy(&v, &bits, sizeof(float));
+			v = Min(v, 1.f);
+			Float srgb = v < 0.0031308 ? 12.92 * v : 1.055 * pow(v, 1.0 / 2.4) - 0.055;
+			table[i] = (unsigned char)(Clamp(srgb, Float(0), Float(1)) * 255 + 0.5);
+		}
+
+		return table;
+	}
+
+	//table is built once by the first caller
+	static const unsigned char* GetSRGBTable() {
+		static const unsigned char* table = BuildSRGBTable();
+
+		return table;
+	}
+
+	//tonemap and quantize in parallel, rows are flipped to top-down order of png
+	void Film::encode(const vector<Vector3f>& input, vector<unsigned char>& output) const {
+		output.resize(3 * res.x * res.y);
+		const unsigned char* srgbTable = GetSRGBTable();
+		Parallel::ParallelFor([&](int y) {
+			const Vector3f* in = &input[(res.y - y - 1) * res.x];
+			unsigned char* out = &output[3 * y * res.x];
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1);
+			if (tonemapMode == Tonemap::E_GAMMA) {
+				const __m128 minValue = _mm_set1_ps(1.f / (1 << 13));
+				const __m128i offset = _mm_set1_epi32(SRGBMinExponent << 8);
+				alignas(16) int idx[4];
+				for (int x = 0; x < res.x; ++x) {
+					__m128 c = _mm_min_ps(_mm_max_ps(in[x].m, minValue), one);
+					__m128i bits = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(c), 15), offset);
+					_mm_store_si128((__m128i*)idx, bits);
+					out[3 * x] = srgbTable[idx[0]];
+					out[3 * x + 1] = srgbTable[idx[1]];
+					out[3 * x + 2] = srgbTable[idx[2]];
+				}
+			}
+			else {
+				//filmic curve of Hejl and Burgess-Dawson, gamma is already included
+				const __m128 a = _mm_set1_ps(6.2), b = _mm_set1_ps(0.5), c = _mm_set1_ps(1.7), d = _mm_set1_ps(0.06);
+				const __m128 bias = _mm_set1_ps(0.004), quantize = _mm_set1_ps(255), half = _mm_set1_ps(0.5);
+				alignas(16) int q[4];
+				for (int x = 0; x < res.x; ++x) {
+					__m128 v = _mm_max_ps(_mm_sub_ps(in[x].m, bias), zero);
+					__m128 av = _mm_mul_ps(a, v);
+					__m128 num = _mm_mul_ps(v, _mm_add_ps(av, b));
+					__m128 den = _mm_add_ps(_mm_mul_ps(v, _mm_add_ps(av, c)), d);
+					v = _mm_min_ps(_mm_max_ps(_mm_div_ps(num, den), zero), one);
+					_mm_store_si128((__m128i*)q, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, quantize), half)));
+					out[3 * x] = q[0];
+					out[3 * x + 1] = q[1];
+					out[3 * x + 2] = q[2];
+				}
+			}
+			}, res.y, 32);
+	}
+
+	//features are saved next to image as name_albedo, name_normal and name_depth in png
+	bool Film::writeAov(const vector<Vector3f>& a, const vector<Vector3f>& n, const vector<Float>& d, Float weight) const {
+		string path = Directory::GetFullPath(filename);
+		size_t dot = path.find_last_of('.');
+		string base = dot == string::npos ? path : path.substr(0, dot);
+		string ext = ".png";
+
+		int nPixels = res.x * res.y;
+		Float maxDepth = 0;
+		for (int i = 0; i < nPixels; ++i) maxDepth = Max(maxDepth, d[i] * weight);
+		Float invDepth = maxDepth > 0 ? 1 / maxDepth : 0;
+
+		vector<Vector3f> albedoImage(nPixels), normalImage(nPixels), depthImage(nPixels);
+		for (int i = 0; i < nPixels; ++i) {
+			albedoImage[i] = a[i] * weight;
+			//map normal from [-1, 1] to [0, 1]
+			normalImage[i] = n[i] * weight * Float(0.5) + Vector3f(0.5);
+			depthImage[i] = Vector3f(d[i] * weight * invDepth);
+		}
+
+		bool success = ImageIO::SavePng((base + "_albedo" + ext).c_str(), res.x, res.y, albedoImage);
+		success &= ImageIO::SavePng((base + "_normal" + ext).c_str(), res.x, res.y, normalImage);
+		success &= ImageIO::SavePng((base + "_depth" + ext).c_str(), res.x, res.y, depthImage);
+
+		return success;
 	}
 
-	Film* CreateFilm(const string& filename, const Vector2i& res, string tonemap, Float scale) {
-		return new Film(filename, res, tonemap, scale);
+	Film* CreateFilm(const string& filename, const Vector2i& res, string tonemap, Float scale,
+		bool aov, bool denoise, int denoiseRadius, bool stream) {
+		return new Film(filename, res, tonemap, scale, aov, denoise, denoiseRadius, stream);
 	}
 }
\ No newline at end of file
@@ -2,8 +2,16 @@
 
 #include "../pol.h"
 #include <mutex>
+#include "imagewriter.h"
+#include "renderblock.h"
+#include "imageio.h"
 
 namespace pol {
+	enum class Tonemap {
+		E_GAMMA,
+		E_FILMIC,
+	};
+
 	class Film {
 	public:
 		//file name to store image
@@ -12,26 +20,80 @@ namespace pol {
 		Vector2i res;
 		//type of tonemap
 		string tonemap;
+		Tonemap tonemapMode;
 		//image data
 		vector<Vector3f> image;
 		Float scale;
+		//feature buffers of first visible surface, summed over samples
+		vector<Vector3f> albedo;
+		vector<Vector3f> normal;
+		vector<Float> depth;
+		//save feature buffers as images
+		bool aov;
+		//denoise image with feature buffers before tonemapping
+		bool denoise;
+		int denoiseRadius;
+		//progressive integrators write image after each pass in background
+		bool progressiveOutput;
+		//finished rows of blocks are written to scanline exr instead of
+		//keeping whole image, only for integrators rendered by blocks
+		bool stream;
 
 		mutex* locks;
+		//created when the first snapshot is written in background
+		ImageWriter* writer;
+
+	private:
+		//row of blocks waiting for its remaining pixels
+		struct StreamRow {
+			vector<Vector3f> pixels;
+			int remaining;
+		};
+
+		Float streamWeight;
+		ExrScanlineWriter* streamWriter;
+		mutex streamMutex;
+		//keyed by first row of blocks
+		map<int, StreamRow*> streamRows;
 
 	public:
-		Film(const string& filename, const Vector2i& res, string tonemap, Float scale);
+		Film(const string& filename, const Vector2i& res, string tonemap, Float scale,
+			bool aov = false, bool denoise = false, int denoiseRadius = 5, bool stream = false);
 		~Film();
 
 		void AddPixel(int p, const Vector3f& c);
 		void AddPixel(const Vector2i& p, const Vector3f& c);
 		void AddSample(int p, const Vector3f& c);
 		void AddSample(const Vector2i& p, const Vector3f& c);
-		bool WriteImage(Float weight);
+		//set final colors of a rendered block
+		void AddBlock(const RenderBlock& rb, const Vector3f* colors);
+		//each pixel is written by only one thread, so no lock here
+		void AddAov(const Vector2i& p, const Vector3f& a, const Vector3f& n, Float d);
+		__forceinline bool HasAov() const { return aov || denoise; }
+		//accumulated image is not modified, so it can be written several times
+		//image is saved as raw hdr if extension of filename is exr or pfm,
+		//otherwise it is tonemapped to 8-bit png
+		bool WriteImage(Float weight) const;
+		//copy current state of film and encode it in background,
+		//should be called between passes so that copy has no partial sample
+		void WriteImageAsync(Float weight);
+
+		//weight is applied when rows are written
+		bool BeginStream(Float weight);
+		bool EndStream();
+		//allocate whole image for integrators which are not rendered by blocks
+		void DisableStream();
+		//release feature buffers for integrators which do not write aov
+		void DisableAov();
 
 	private:
-		Vector3f filmic(const Vector3f& c) const;
-		Vector3f gamma(const Vector3f& c) const;
+		bool write(const vector<Vector3f>& color, const vector<Vector3f>& a, const vector<Vector3f>& n,
+			const vector<Float>& d, Float weight) const;
+		void resolve(const vector<Vector3f>& input, Float weight, vector<Vector3f>& output) const;
+		void encode(const vector<Vector3f>& input, vector<unsigned char>& output) const;
+		bool writeAov(const vector<Vector3f>& a, const vector<Vector3f>& n, const vector<Float>& d, Float weight) const;
 	};
 
-	Film* CreateFilm(const string& filename, const Vector2i& res, string tonemap = "gamma", Float scale = 1);
+	Film* CreateFilm(const string& filename, const Vector2i& res, string tonemap = "gamma", Float scale = 1,
+		bool aov = false, bool denoise = false, int denoiseRadius = 5, bool stream = false);
 }
\ No newline at end of file
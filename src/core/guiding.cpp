@@ -0,0 +1,247 @@
+#include "guiding.h"
+
+namespace pol {
+	DTree::DTree() {
+		nodes.resize(1);
+	}
+
+	void DTree::Record(const Vector2f& p, Float value) {
+		Vector2f q = p;
+		int idx = 0;
+		while (true) {
+			int x = q.x >= 0.5 ? 1 : 0;
+			int y = q.y >= 0.5 ? 1 : 0;
+			int c = x + 2 * y;
+			Node& node = nodes[idx];
+			node.sums[c].Add(value);
+			if (node.children[c] == 0) break;
+
+			idx = node.children[c];
+			q = Vector2f(q.x * 2 - x, q.y * 2 - y);
+		}
+	}
+
+	//pdf is product of 4*fraction of each level
+	Float DTree::Pdf(const Vector2f& p) const {
+		Vector2f q = p;
+		Float pdf = 1;
+		int idx = 0;
+		while (true) {
+			const Node& node = nodes[idx];
+			Float total = node.sums[0] + node.sums[1] + node.sums[2] + node.sums[3];
+			if (total <= 0) break;
+
+			int x = q.x >= 0.5 ? 1 : 0;
+			int y = q.y >= 0.5 ? 1 : 0;
+			int c = x + 2 * y;
+			pdf *= 4 * node.sums[c] / total;
+			if (node.children[c] == 0) break;
+
+			idx = node.children[c];
+			q = Vector2f(q.x * 2 - x, q.y * 2 - y);
+		}
+
+		return pdf;
+	}
+
+	//choose horizontal half first then vertical half,
+	//random numbers are remapped at each level
+	Vector2f DTree::Sample(const Vector2f& u) const {
+		Vector2f v = u;
+		Vector2f origin(0, 0);
+		Float size = 1;
+		int idx = 0;
+		while (true) {
+			const Node& node = nodes[idx];
+			Float s[4] = { node.sums[0], node.sums[1], node.sums[2], node.sums[3] };
+			Float total = s[0] + s[1] + s[2] + s[3];
+			if (total <= 0) break;
+
+			int x = 0, y = 0;
+			Float left = s[0] + s[2];
+			Float pLeft = left / total;
+			if (v.x < pLeft) {
+				v.x = v.x / pLeft;
+			}
+			else {
+				x = 1;
+				v.x = (v.x - pLeft) / (1 - pLeft);
+			}
+
+			Float column = s[x] + s[x + 2];
+			Float pBottom = s[x] / column;
+			if (v.y < pBottom) {
+				v.y = v.y / pBottom;
+			}
+			else {
+				y = 1;
+				v.y = (v.y - pBottom) / (1 - pBottom);
+			}
+
+			size *= 0.5;
+			origin = origin + Vector2f(x * size, y * size);
+			int c = x + 2 * y;
+			if (node.children[c] == 0) break;
+
+			idx = node.children[c];
+		}
+
+		v.x = Clamp(v.x, Float(0), Float(0.99999994));
+		v.y = Clamp(v.y, Float(0), Float(0.99999994));
+		return origin + v * size;
+	}
+
+	void DTree::Refine(const DTree& prev, Float threshold, int maxDepth) {
+		struct Entry {
+			int node;
+			//node of previous tree, -1 if previous tree is coarser here
+			int prevNode;
+			Float energy;
+			int depth;
+		};
+
+		nodes.clear();
+		nodes.resize(1);
+
+		Float total = prev.Energy();
+		if (total <= 0) {
+			//nothing learned, keep structure
+			nodes = prev.nodes;
+			for (Node& node : nodes) for (int i = 0; i < 4; ++i) node.sums[i] = 0;
+			return;
+		}
+
+		vector<Entry> stack;
+		stack.push_back({ 0, 0, total, 1 });
+		while (!stack.empty()) {
+			Entry entry = stack.back();
+			stack.pop_back();
+
+			for (int c = 0; c < 4; ++c) {
+				Float energy = entry.energy * 0.25;
+				int prevChild = -1;
+				if (entry.prevNode >= 0) {
+					const Node& prevNode = prev.nodes[entry.prevNode];
+					energy = prevNode.sums[c];
+					if (prevNode.children[c]) prevChild = prevNode.children[c];
+				}
+
+				if (energy > total * threshold && entry.depth < maxDepth) {
+					int child = nodes.size();
+					nodes.push_back(Node());
+					nodes[entry.node].children[c] = child;
+					stack.push_back({ child, prevChild, energy, entry.depth + 1 });
+				}
+			}
+		}
+	}
+
+	Float DTree::Energy() const {
+		const Node& root = nodes[0];
+		return root.sums[0] + root.sums[1] + root.sums[2] + root.sums[3];
+	}
+
+	Vector2f DTree::DirToCanonical(const Vector3f& d) {
+		Float cosTheta = Clamp(d.Z(), Float(-1), Float(1));
+		Float phi = atan2(d.Y(), d.X());
+		if (phi < 0) phi += TWOPI;
+
+		return Vector2f((cosTheta + 1) * 0.5, Clamp(Float(phi * INV2PI), Float(0), Float(0.99999994)));
+	}
+
+	Vector3f DTree::CanonicalToDir(const Vector2f& p) {
+		Float cosTheta = 2 * p.x - 1;
+		Float sinTheta = sqrt(Max(Float(0), 1 - cosTheta * cosTheta));
+		Float phi = TWOPI * p.y;
+
+		return Vector3f(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+	}
+
+	void SDTree::DTreeWrapper::Record(const Vector3f& dir, Float value) {
+		if (!(value > 0) || isinf(value)) return;
+
+		building.Record(DTree::DirToCanonical(dir), value);
+		sampleCount++;
+	}
+
+	Float SDTree::DTreeWrapper::Pdf(const Vector3f& dir) const {
+		return sampling.Pdf(DTree::DirToCanonical(dir)) * INV4PI;
+	}
+
+	Vector3f SDTree::DTreeWrapper::Sample(const Vector2f& u) const {
+		return DTree::CanonicalToDir(sampling.Sample(u));
+	}
+
+	SDTree::SDTree(const BBox& bbox) {
+		//use cube bounds, so that splitting along alternate axes keeps cells uniform
+		Vector3f center = bbox.Center();
+		Float extent = HMax(bbox.Diagonal()) * Float(0.5) + Epsilon;
+		bounds = BBox(center - Vector3f(extent), center + Vector3f(extent));
+
+		nodes.push_back({ 0, {0, 0}, 0 });
+		dTrees.push_back(new DTreeWrapper());
+		iteration = 0;
+	}
+
+	SDTree::~SDTree() {
+		for (DTreeWrapper* w : dTrees) delete w;
+	}
+
+	SDTree::DTreeWrapper* SDTree::Lookup(const Vector3f& p) const {
+		Vector3f pn = (p - bounds.fmin) / bounds.Diagonal();
+		Float q[3] = { pn.X(), pn.Y(), pn.Z() };
+		for (int i = 0; i < 3; ++i) q[i] = Clamp(q[i], Float(0), Float(1));
+
+		int idx = 0;
+		while (nodes[idx].children[0]) {
+			const Node& node = nodes[idx];
+			Float& c = q[node.axis];
+			if (c < 0.5) {
+				c = c * 2;
+				idx = node.children[0];
+			}
+			else {
+				c = c * 2 - 1;
+				idx = node.children[1];
+			}
+		}
+
+		return dTrees[nodes[idx].dTree];
+	}
+
+	//spatial leaf is split if it receives enough samples,
+	//the threshold grows as sqrt of samples per pass
+	void SDTree::Refine() {
+		const Float spatialThreshold = 12000 * sqrt(Float(1 << Min(iteration, 30)));
+		const Float directionalThreshold = 0.01;
+		const int maxDirectionalDepth = 20;
+
+		int nNodes = nodes.size();
+		for (int i = 0; i < nNodes; ++i) {
+			if (nodes[i].children[0]) continue;
+
+			DTreeWrapper* w = dTrees[nodes[i].dTree];
+			if (w->sampleCount <= spatialThreshold) continue;
+
+			//children inherit statistics of parent
+			int halfCount = w->sampleCount / 2;
+			w->sampleCount = halfCount;
+			DTreeWrapper* sibling = new DTreeWrapper(*w);
+			int axis = nodes[i].axis;
+			int c0 = nodes.size();
+			nodes.push_back({ (axis + 1) % 3, {0, 0}, nodes[i].dTree });
+			nodes.push_back({ (axis + 1) % 3, {0, 0}, int(dTrees.size()) });
+			dTrees.push_back(sibling);
+			nodes[i].children[0] = c0;
+			nodes[i].children[1] = c0 + 1;
+		}
+
+		for (DTreeWrapper* w : dTrees) {
+			w->sampling = w->building;
+			w->building.Refine(w->sampling, directionalThreshold, maxDirectionalDepth);
+			w->sampleCount = 0;
+		}
+
+		iteration++;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../pol.h"
+#include "parallel.h"
+
+namespace pol {
+	//directional quadtree over the square [0, 1]^2
+	//direction is mapped to the square by (cos(theta), phi) which preserves area,
+	//so pdf over sphere is pdf over square divided by 4*PI
+	class DTree {
+	private:
+		struct Node {
+			//energy of each quadrant
+			AtomicFloat sums[4];
+			//index of children, 0 means the quadrant is leaf
+			int children[4];
+
+			Node() { for (int i = 0; i < 4; ++i) children[i] = 0; }
+		};
+
+		vector<Node> nodes;
+
+	public:
+		DTree();
+
+		//add energy to all nodes containing the point, thread safe
+		void Record(const Vector2f& p, Float value);
+		Float Pdf(const Vector2f& p) const;
+		Vector2f Sample(const Vector2f& u) const;
+
+		//rebuild structure from energy of previous tree,
+		//quadrant holding more than threshold of total energy is subdivided
+		void Refine(const DTree& prev, Float threshold, int maxDepth);
+		Float Energy() const;
+
+		static Vector2f DirToCanonical(const Vector3f& d);
+		static Vector3f CanonicalToDir(const Vector2f& p);
+	};
+
+	//spatial binary tree whose leaves hold directional quadtrees
+	//training records into building trees and sampling only reads sampling trees,
+	//both trees are restructured between passes, so no lock is needed while rendering
+	class SDTree {
+	public:
+		struct DTreeWrapper {
+			DTree building;
+			DTree sampling;
+			atomic<int> sampleCount;
+
+			DTreeWrapper() :sampleCount(0) {}
+			DTreeWrapper(const DTreeWrapper& w) :building(w.building), sampling(w.sampling), sampleCount(int(w.sampleCount)) {}
+
+			void Record(const Vector3f& dir, Float value);
+			Float Pdf(const Vector3f& dir) const;
+			Vector3f Sample(const Vector2f& u) const;
+		};
+
+	private:
+		struct Node {
+			int axis;
+			//index of children, 0 means leaf
+			int children[2];
+			int dTree;
+		};
+
+		BBox bounds;
+		vector<Node> nodes;
+		vector<DTreeWrapper*> dTrees;
+		int iteration;
+
+	public:
+		SDTree(const BBox& bbox);
+		~SDTree();
+
+		DTreeWrapper* Lookup(const Vector3f& p) const;
+		//must be called when no thread is rendering
+		void Refine();
+		//sampling trees are learned from at least one pass
+		bool IsTrained() const { return iteration > 0; }
+	};
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "imageio.h"
+#include "parallel.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb\stb_image.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -9,53 +10,61 @@
 #include <tinyexr\tinyexr.h>
 
 namespace pol {
-	bool ImageIO::LoadTexture(const char* filename, int& width, int& height, bool srgb, bool flip, vector<Vector3f>& output) {
-		int component;
-		stbi_set_flip_vertically_on_load(flip);
-		unsigned char* tex = stbi_load(filename, &width, &height, &component, 0);
-		if (tex) {
-			output.resize(width * height);
-			float inv = 1.f / 255.f;
-			for (int s = 0; s < height; ++s) {
-				for (int t = 0; t < width; ++t) {
-					//flip
-					int idx = s * width + t;
-					//int inverseIdx = (height - s - 1)*width + t;
-
-					Vector3f texel;
-					if (component == 1) {
-						float r = tex[idx] * inv;
-						texel = Vector3f(r, r, r);
-					}
-					else if (component == 3) {
-						float r = tex[3 * idx] * inv;
-						float g = tex[3 * idx + 1] * inv;
-						float b = tex[3 * idx + 2] * inv;
-						texel = Vector3f(r, g, b);
-					}
-					else if (component == 4) {
-						float r = tex[4 * idx] * inv;
-						float g = tex[4 * idx + 1] * inv;
-						float b = tex[4 * idx + 2] * inv;
-						float a = tex[4 * idx + 3] * inv;
-						texel = Vector3f(r, g, b);
-					}
-
-					//convert from srgb space to linear space
-					if (srgb)
-						output[idx] = Vector3f(powf(texel.X(), 2.2f), powf(texel.Y(), 2.2f), powf(texel.Z(), 2.2f));
-					else
-						output[idx] = texel;
-				}
-			}
+	//linear table is followed by gamma table
+	static const float* BuildDecodeTables() {
+		static float tables[512];
+		for (int i = 0; i < 256; ++i) {
+			tables[i] = i / 255.f;
+			tables[256 + i] = powf(tables[i], 2.2f);
+		}
+
+		return tables;
+	}
+
+	const float* ImageIO::GetDecodeTable(bool srgb) {
+		//tables are built once by the first caller
+		static const float* tables = BuildDecodeTables();
+
+		return srgb ? tables + 256 : tables;
+	}
 
-			stbi_image_free(tex);
+	//gray and gray-alpha texels are expanded to 3 channels, alpha is dropped
+	template<int nComponent>
+	static void DecodeRow(const unsigned char* in, const float* table, Vector3f* out, int width) {
+		for (int i = 0; i < width; ++i) {
+			const unsigned char* t = in + i * nComponent;
+			if (nComponent < 3) out[i] = Vector3f(table[t[0]]);
+			else out[i] = Vector3f(table[t[0]], table[t[1]], table[t[2]]);
 		}
-		else {
+	}
+
+	bool ImageIO::LoadTexture(const char* filename, int& width, int& height, bool srgb, bool flip, vector<Vector3f>& output,
+		int* components) {
+		int component;
+		//flag of stb is global, so rows are flipped here to load textures in parallel
+		unsigned char* tex = stbi_load(filename, &width, &height, &component, 0);
+		if (!tex) {
 			fprintf(stderr, "Error when load texture [%s]\n", filename);
 			return false;
 		}
 
+		if (components) *components = component;
+		output.resize(width * height);
+		const float* table = GetDecodeTable(srgb);
+		int w = width, h = height;
+		Parallel::ParallelFor([&](int y) {
+			const unsigned char* in = tex + size_t(flip ? h - y - 1 : y) * w * component;
+			Vector3f* out = &output[size_t(y) * w];
+			switch (component) {
+			case 1: DecodeRow<1>(in, table, out, w); break;
+			case 2: DecodeRow<2>(in, table, out, w); break;
+			case 3: DecodeRow<3>(in, table, out, w); break;
+			default: DecodeRow<4>(in, table, out, w); break;
+			}
+			}, h, 32);
+
+		stbi_image_free(tex);
+
 		return true;
 	}
 
@@ -97,6 +106,16 @@ namespace pol {
 		return true;
 	}
 
+	bool ImageIO::SavePng(const char* filename, int width, int height, const unsigned char* input) {
+		int ret = stbi_write_png(filename, width, height, 3, input, 0);
+		if (!ret) {
+			fprintf(stderr, "Error when save png [%s]\n", filename);
+			return false;
+		}
+
+		return true;
+	}
+
 	bool ImageIO::LoadExr(const char* filename, int& width, int& height, vector<Vector3f>& output) {
 		const char* err = NULL; // or nullptr in C++11
 
@@ -180,4 +199,141 @@ namespace pol {
 
 		return true;
 	}
+
+	bool ImageIO::SavePfm(const char* filename, int width, int height, const vector<Vector3f>& input) {
+		FILE* fp = fopen(filename, "wb");
+		if (!fp) {
+			fprintf(stderr, "Error when save pfm [%s]\n", filename);
+			return false;
+		}
+
+		//negative scale means little endian
+		fprintf(fp, "PF\n%d %d\n-1.0\n", width, height);
+		vector<float> row(3 * width);
+		for (int i = 0; i < height; ++i) {
+			for (int j = 0; j < width; ++j) {
+				const Vector3f& c = input[i * width + j];
+				row[3 * j] = c.X();
+				row[3 * j + 1] = c.Y();
+				row[3 * j + 2] = c.Z();
+			}
+
+			fwrite(&row[0], sizeof(float), row.size(), fp);
+		}
+
+		fclose(fp);
+
+		return true;
+	}
+
+	ExrScanlineWriter::ExrScanlineWriter()
+		:fp(nullptr), width(0), height(0), dataStart(0) {
+
+	}
+
+	ExrScanlineWriter::~ExrScanlineWriter() {
+		Close();
+	}
+
+	static void WriteExrAttribute(vector<char>& header, const char* name, const char* type, const void* data, int size) {
+		header.insert(header.end(), name, name + strlen(name) + 1);
+		header.insert(header.end(), type, type + strlen(type) + 1);
+		const char* s = (const char*)&size;
+		header.insert(header.end(), s, s + sizeof(int));
+		const char* d = (const char*)data;
+		header.insert(header.end(), d, d + size);
+	}
+
+	static int SeekFile(FILE* fp, uint64_t offset) {
+#ifdef _WIN32
+		return _fseeki64(fp, offset, SEEK_SET);
+#else
+		return fseeko(fp, offset, SEEK_SET);
+#endif
+	}
+
+	bool ExrScanlineWriter::Open(const char* filename, int w, int h) {
+		Close();
+		fp = fopen(filename, "wb");
+		if (!fp) {
+			fprintf(stderr, "Error when save exr [%s]\n", filename);
+			return false;
+		}
+
+		width = w;
+		height = h;
+
+		//magic number and version 2 of single part scanline file
+		vector<char> header = { 0x76, 0x2f, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00 };
+
+		//channels are sorted by name, all of them are 32-bit float
+		vector<char> channels;
+		const char* names[3] = { "B", "G", "R" };
+		for (int i = 0; i < 3; ++i) {
+			channels.insert(channels.end(), names[i], names[i] + 2);
+			int info[4] = { 2, 0, 1, 1 };
+			const char* p = (const char*)info;
+			channels.insert(channels.end(), p, p + sizeof(info));
+		}
+		channels.push_back(0);
+		WriteExrAttribute(header, "channels", "chlist", &channels[0], channels.size());
+
+		char compression = 0;
+		WriteExrAttribute(header, "compression", "compression", &compression, 1);
+		int window[4] = { 0, 0, width - 1, height - 1 };
+		WriteExrAttribute(header, "dataWindow", "box2i", window, sizeof(window));
+		WriteExrAttribute(header, "displayWindow", "box2i", window, sizeof(window));
+		char lineOrder = 0;
+		WriteExrAttribute(header, "lineOrder", "lineOrder", &lineOrder, 1);
+		float aspect = 1;
+		WriteExrAttribute(header, "pixelAspectRatio", "float", &aspect, sizeof(float));
+		float center[2] = { 0, 0 };
+		WriteExrAttribute(header, "screenWindowCenter", "v2f", center, sizeof(center));
+		float screenWidth = 1;
+		WriteExrAttribute(header, "screenWindowWidth", "float", &screenWidth, sizeof(float));
+		header.push_back(0);
+
+		//one scanline per block without compression
+		uint64_t blockSize = 2 * sizeof(int) + uint64_t(width) * 3 * sizeof(float);
+		dataStart = header.size() + uint64_t(height) * sizeof(uint64_t);
+		vector<uint64_t> offsets(height);
+		for (int i = 0; i < height; ++i) offsets[i] = dataStart + i * blockSize;
+
+		fwrite(&header[0], 1, header.size(), fp);
+		fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), fp);
+
+		return true;
+	}
+
+	bool ExrScanlineWriter::WriteRows(int y, int count, const Vector3f* rows) {
+		if (!fp) return false;
+
+		uint64_t blockSize = 2 * sizeof(int) + uint64_t(width) * 3 * sizeof(float);
+		vector<char> block(blockSize * count);
+		for (int r = 0; r < count; ++r) {
+			char* b = &block[r * blockSize];
+			int line = y + r;
+			int size = width * 3 * sizeof(float);
+			memcpy(b, &line, sizeof(int));
+			memcpy(b + sizeof(int), &size, sizeof(int));
+			//channels of a scanline are stored one after another in order of B, G, R
+			float* data = (float*)(b + 2 * sizeof(int));
+			const Vector3f* row = rows + r * width;
+			for (int x = 0; x < width; ++x) {
+				data[x] = row[x].Z();
+				data[width + x] = row[x].Y();
+				data[2 * width + x] = row[x].X();
+			}
+		}
+
+		lock_guard<mutex> lock(fileMutex);
+		if (SeekFile(fp, dataStart + y * blockSize)) return false;
+
+		return fwrite(&block[0], 1, block.size(), fp) == block.size();
+	}
+
+	void ExrScanlineWriter::Close() {
+		if (fp) fclose(fp);
+		fp = nullptr;
+	}
 }
\ No newline at end of file
@@ -1,14 +1,45 @@
 #pragma once
 
 #include "../pol.h"
+#include <mutex>
 
 namespace pol {
 	class ImageIO {
 	public:
-		static bool LoadTexture(const char* filename, int& width, int& height, bool srgb, bool flip, vector<Vector3f>& output);
+		//components : channel count of source image if not null
+		static bool LoadTexture(const char* filename, int& width, int& height, bool srgb, bool flip, vector<Vector3f>& output,
+			int* components = nullptr);
+		//8-bit to float table, srgb values are converted to linear space
+		static const float* GetDecodeTable(bool srgb);
 		static bool SavePng(const char* filename, int width, int height, const vector<Vector3f>& input);
 		static bool SavePng(const char* filename, int width, int height, const Vector3f* input);
+		//8-bit rgb stored from top row to bottom row
+		static bool SavePng(const char* filename, int width, int height, const unsigned char* input);
 		static bool LoadExr(const char* filename, int& width, int& height, vector<Vector3f>& output);
 		static bool SaveExr(const char* filename, int width, int height, const vector<Vector3f>& input);
+		//rows of pfm are stored from bottom to top, same as film
+		static bool SavePfm(const char* filename, int width, int height, const vector<Vector3f>& input);
+	};
+
+	//uncompressed scanline exr whose rows can be written in any order
+	//size of every scanline block is fixed, so offset table is written
+	//when file is opened and each row is written at its own place.
+	//only rows in flight are kept in memory
+	class ExrScanlineWriter {
+	private:
+		FILE* fp;
+		int width, height;
+		//file offset of first scanline block
+		uint64_t dataStart;
+		mutex fileMutex;
+
+	public:
+		ExrScanlineWriter();
+		~ExrScanlineWriter();
+
+		bool Open(const char* filename, int width, int height);
+		//y is index of first row from top, thread safe
+		bool WriteRows(int y, int count, const Vector3f* rows);
+		void Close();
 	};
 }
\ No newline at end of file
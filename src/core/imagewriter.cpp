@@ -0,0 +1,57 @@
+#include "imagewriter.h"
+#include "parallel.h"
+
+namespace pol {
+	ImageWriter::ImageWriter(int capacity)
+		:capacity(Max(capacity, 1)), busy(false), stop(false) {
+		worker = thread(&ImageWriter::run, this);
+	}
+
+	ImageWriter::~ImageWriter() {
+		{
+			lock_guard<mutex> lock(jobMutex);
+			stop = true;
+		}
+		jobAdded.notify_one();
+		worker.join();
+	}
+
+	void ImageWriter::Push(function<void()> job) {
+		unique_lock<mutex> lock(jobMutex);
+		jobDone.wait(lock, [&]() { return jobs.size() < capacity; });
+		jobs.push_back(job);
+		lock.unlock();
+		jobAdded.notify_one();
+	}
+
+	void ImageWriter::Flush() {
+		unique_lock<mutex> lock(jobMutex);
+		jobDone.wait(lock, [&]() { return jobs.empty() && !busy; });
+	}
+
+	void ImageWriter::run() {
+		Parallel::SetBackgroundThread();
+		while (true) {
+			function<void()> job;
+			{
+				unique_lock<mutex> lock(jobMutex);
+				jobAdded.wait(lock, [&]() { return stop || !jobs.empty(); });
+				if (jobs.empty()) return;
+
+				job = jobs.front();
+				jobs.pop_front();
+				busy = true;
+			}
+			//a slot is free for pushing thread
+			jobDone.notify_all();
+
+			job();
+
+			{
+				lock_guard<mutex> lock(jobMutex);
+				busy = false;
+			}
+			jobDone.notify_all();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../pol.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace pol {
+	//background thread encoding images while rendering continues
+	//jobs are kept in a bounded queue, pushing to a full queue blocks
+	//until the oldest job is done, so memory of pending snapshots is bounded
+	class ImageWriter {
+	private:
+		deque<function<void()>> jobs;
+		int capacity;
+		//job being encoded
+		bool busy;
+		bool stop;
+		mutex jobMutex;
+		condition_variable jobAdded;
+		condition_variable jobDone;
+		thread worker;
+
+	public:
+		ImageWriter(int capacity = 2);
+		//pending jobs are finished before exit
+		~ImageWriter();
+
+		void Push(function<void()> job);
+		//wait until all jobs are done
+		void Flush();
+
+	private:
+		void run();
+	};
+}
\ No newline at end of file
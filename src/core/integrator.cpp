@@ -9,4 +9,53 @@ namespace pol {
 	Integrator::~Integrator() {
 
 	}
+
+	void AovSample::SetSurface(const Ray& ray, const Intersection& isect) {
+		normal = isect.shFrame.ToWorld(Vector3f(0, 1, 0));
+		depth = (isect.p - ray.o).Length();
+		//emitted color is kept in demodulated image
+		if (isect.light) albedo = Vector3f::One();
+	}
+
+	Light* SampleLightRIS(const Scene& scene, const Distribution1D* lightDistribution, const Intersection& isect, const Vector3f& localIn, const Sampler* sampler, int nCandidates,
+		Vector3f& radiance, Float& lightPdf, Ray& shadowRay, Float& invPdf) {
+		Light* chosen = nullptr;
+		Float wSum = 0, chosenTarget = 0;
+		lightPdf = 0;
+		//streaming selection, the i-th candidate replaces the chosen one with probability w/sum(w)
+		for (int i = 0; i < nCandidates; ++i) {
+			Float choicePdf;
+			int lightIdx = scene.LightSample(lightDistribution, isect.p, isect.n, sampler->Next1D(), choicePdf);
+			Vector2f u = sampler->Next2D();
+			Float uSelect = sampler->Next1D();
+			if (lightIdx < 0) continue;
+
+			Light* light = scene.GetLight(lightIdx);
+			Vector3f rad;
+			Float pdf = 0;
+			Ray ray;
+			light->SampleLight(isect, u, rad, pdf, ray);
+			if (pdf == 0) continue;
+
+			Vector3f fr;
+			Float bsdfPdf;
+			isect.bsdf->Fr(isect, localIn, isect.shFrame.ToLocal(ray.d), fr, bsdfPdf);
+			Float target = GetLuminance(fr * rad);
+			if (!(target > 0)) continue;
+
+			Float w = target / (pdf * choicePdf);
+			wSum += w;
+			if (uSelect * wSum < w) {
+				chosen = light;
+				radiance = rad;
+				lightPdf = pdf * choicePdf;
+				shadowRay = ray;
+				chosenTarget = target;
+			}
+		}
+
+		if (chosen) invPdf = wSum / (nCandidates * chosenTarget);
+
+		return chosen;
+	}
 }
\ No newline at end of file
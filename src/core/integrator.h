@@ -3,6 +3,8 @@
 #include "object.h"
 #include "warp.h"
 #include "ray.h"
+#include "intersection.h"
+#include "distribution.h"
 
 namespace pol {
 	//monte carlo method
@@ -46,14 +48,42 @@ namespace pol {
 	//      E[F] = f(x)dx
 	class Scene;
 	class Sampler;
+	class Light;
+	//features of first visible surface used by denoiser, written by Li
+	struct AovSample {
+		//expectation over samples is directional albedo of surface
+		Vector3f albedo;
+		Vector3f normal;
+		Float depth;
+
+		AovSample() :albedo(Vector3f::Zero()), normal(Vector3f::Zero()), depth(0) {}
+
+		//normal and depth of first hit, albedo is left to integrator
+		void SetSurface(const Ray& ray, const Intersection& isect);
+	};
+
 	class Integrator : public PolObject {
 	public:
 		Integrator(const PropSets& props, Scene& scene);
 		virtual ~Integrator();
 
-		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const = 0;
+		//aov of first visible surface is filled if it is not null
+		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov = nullptr) const = 0;
 		//for bidirectional method
 		virtual void Render(const Scene& scene) const {};
 		virtual bool IsBidirectional() const { return false; }
+		//integrator renders itself in several passes
+		virtual bool IsProgressive() const { return false; }
+		//Li fills aov, aov and denoise are disabled otherwise
+		virtual bool HasAov() const { return false; }
 	};
+
+	//resampled importance sampling for direct lighting
+	//M candidates are drawn from light distribution and one of them is chosen
+	//proportional to w = p^(x)/p(x), where target p^ is unshadowed contribution
+	//luminance(fr*Le). the estimator of chosen sample y is
+	//      F = f(y)/p^(y) * 1/M * sum(w)
+	//invPdf returns 1/p^(y) * 1/M * sum(w), and lightPdf returns source pdf of y for MIS
+	Light* SampleLightRIS(const Scene& scene, const Distribution1D* lightDistribution, const Intersection& isect, const Vector3f& localIn, const Sampler* sampler, int nCandidates,
+		Vector3f& radiance, Float& lightPdf, Ray& shadowRay, Float& invPdf);
 }
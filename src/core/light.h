@@ -8,11 +8,18 @@ namespace pol {
 	class Scene;
 	class Shape;
 	class Light : public PolObject {
+	protected:
+		//index of light in scene
+		int index;
+
 	public:
 		Light(const PropSets& props, Scene& scene);
 		virtual ~Light();
 
-		//for area light
+		void SetIndex(int i) { index = i; }
+		int GetIndex() const { return index; }
+
+		//for area light, can be called several times for a light made of several shapes
 		virtual void SetShape(Shape* s) {};
 		//for distant and infinite light
 		virtual void Prepare(const Scene& scene) {};
@@ -34,5 +41,12 @@ namespace pol {
 		virtual Vector3f Le(const Vector3f& in, const Vector3f& nor) const {
 			return Vector3f::Zero();
 		}
+
+		//spatial and directional bounds for light bvh
+		//axis and cosThetaO bound the normals, cosThetaE bounds emission around a normal
+		//return false if light has no finite bounds
+		virtual bool GetBounds(BBox& bbox, Vector3f& axis, Float& cosThetaO, Float& cosThetaE) const {
+			return false;
+		}
 	};
 }
\ No newline at end of file
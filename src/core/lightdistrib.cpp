@@ -1,5 +1,7 @@
 #include "lightdistrib.h"
 #include "scene.h"
+#include "parallel.h"
+#include "rng.h"
 
 namespace pol {
 	LightDistribution::LightDistribution() {
@@ -10,6 +12,17 @@ namespace pol {
 
 	}
 
+	int LightDistribution::Sample(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, Float u, Float& pdf) const {
+		int idx = distribution->SampleAliasDiscrete(u);
+		pdf = distribution->DiscretePdf(idx);
+
+		return idx;
+	}
+
+	Float LightDistribution::Pdf(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, int lightIdx) const {
+		return distribution->DiscretePdf(lightIdx);
+	}
+
 	UniformLightDistribution::UniformLightDistribution(const Scene& scene) {
 		vector<Float> luminance;
 		vector<Light*> lights = scene.GetLight();
@@ -46,13 +59,35 @@ namespace pol {
 		Float unit = maxVoxel / maxLen;
 		//calculate the num of voxels along three axis
 		for (int i = 0; i < 3; ++i) {
-			nVoxels[i] = ceil(diag[i] * unit);
+			nVoxels[i] = Max(1, int(ceil(diag[i] * unit)));
+		}
+
+		//table is much larger than voxels which are really used,
+		//so probing sequences are short
+		int hashTableSize = 4 * nVoxels.x * nVoxels.y * nVoxels.z;
+		hashTable = vector<HashEntry>(hashTableSize);
+		for (HashEntry& entry : hashTable) {
+			entry.packedPos.store(~uint64_t(0));
+			entry.distribution.store(nullptr);
+		}
+
+		vector<Float> luminance;
+		vector<Light*> lights = scene.GetLight();
+		luminance.reserve(lights.size());
+		for (const Light* light : lights) {
+			luminance.push_back(light->Luminance());
 		}
+		fallback = Distribution1D(&luminance[0], luminance.size());
+	}
 
-		entries.resize(nVoxels.x * nVoxels.y * nVoxels.z);
+	SpatialLightDistribution::~SpatialLightDistribution() {
+		for (HashEntry& entry : hashTable) {
+			Distribution1D* distribution = entry.distribution.load();
+			POL_SAFE_DELETE(distribution);
+		}
 	}
 
-	const Distribution1D* SpatialLightDistribution::Lookup(const Vector3f& p) const {
+	Vector3i SpatialLightDistribution::voxel(const Vector3f& p) const {
 		BBox worldBBox = scene.GetBBox();
 		Vector3f offset = worldBBox.Offset(p);
 		Vector3i pi = nVoxels * offset;
@@ -60,68 +95,459 @@ namespace pol {
 		pi.y = Clamp(pi.y, 0, nVoxels.y - 1);
 		pi.z = Clamp(pi.z, 0, nVoxels.z - 1);
 
-		int index = pi.z * nVoxels.y * nVoxels.x + pi.y * nVoxels.x + pi.x;
-		if (entries[index].valid) {
-			return &entries[index].distrib;
+		return pi;
+	}
+
+	const Distribution1D* SpatialLightDistribution::Lookup(const Vector3f& p) const {
+		const uint64_t invalid = ~uint64_t(0);
+		Vector3i pi = voxel(p);
+		uint64_t packedPos = (uint64_t(pi.x) << 40) | (uint64_t(pi.y) << 20) | uint64_t(pi.z);
+		uint64_t hash = MixBits(packedPos) % hashTable.size();
+		uint64_t step = 1;
+		while (true) {
+			HashEntry& entry = hashTable[hash];
+			uint64_t entryPos = entry.packedPos.load(memory_order_acquire);
+			if (entryPos == packedPos) {
+				//the voxel may be still computed by another thread,
+				//use power distribution instead of waiting, callers keep
+				//the returned distribution for both sampling and pdf
+				Distribution1D* distribution = entry.distribution.load(memory_order_acquire);
+				return distribution ? distribution : &fallback;
+			}
+			else if (entryPos == invalid) {
+				//try to claim the empty entry
+				uint64_t expected = invalid;
+				if (entry.packedPos.compare_exchange_strong(expected, packedPos, memory_order_acq_rel)) {
+					Distribution1D* distribution = computeDistribution(pi);
+					entry.distribution.store(distribution, memory_order_release);
+					return distribution;
+				}
+
+				//another thread claimed it, check the entry again
+				continue;
+			}
+
+			//quadratic probing
+			hash = (hash + step * step) % hashTable.size();
+			++step;
 		}
-		else {
-			//compute distribution
-
-			//calculate the bbox that the point p within. 
-			Vector3f diag = worldBBox.Diagonal();
-			Float maxLen = diag[diag.MajorComponent()];
-			Float voxelLen = maxLen / nVoxels[nVoxels.MajorComponent()];
-			Vector3f fmin = Vector3f(pi.x * voxelLen, pi.y * voxelLen, pi.z * voxelLen) + worldBBox.fmin;
-			Vector3f fmax = fmin + voxelLen;
-			BBox voxelBBox = BBox(fmin, fmax);
-
-			// Compute the sampling distribution. Sample a number of points inside
-			// voxelBounds using a 3D Halton sequence; at each one, sample each
-			// light source and compute a weight based on Li/pdf for the light's
-			// sample (ignoring visibility between the point in the voxel and the
-			// point on the light source) as an approximation to how much the light
-			// is likely to contribute to illumination in the voxel.
-			const int nSamples = 128;
-			vector<Light*> lights = scene.GetLight();
-			vector<Float> distribution(lights.size(), Float(0));
-			for (int i = 0; i < nSamples; ++i) {
-				Vector3f p = voxelBBox.Lerp(Vector3f(RadicalInverse(0, i),
-					RadicalInverse(1, i), RadicalInverse(2, i)));
-				
-				Intersection isect;
-				isect.p = p;
-
-				Vector2f u = Vector2f(RadicalInverse(3, i), RadicalInverse(4, i));
-				for (int j = 0; j < lights.size(); ++j) {
-					Light* light = lights[j];
-					Vector3f radiance;
-					Float pdf;
-					Ray shadowRay;
-					light->SampleLight(isect, u, radiance, pdf, shadowRay);
-					if (pdf != 0) {
-						Float scale = 1;
-						//if the point is occulded, then reduce contribution
-						if (scene.Occluded(shadowRay)) {
-							scale = 0.1;
-						}
-						distribution[j] += GetLuminance(radiance) / pdf * scale;
-					}
+	}
+
+	void SpatialLightDistribution::Precompute() {
+		BBox worldBBox = scene.GetBBox();
+
+		//voxels overlapped by primitives
+		vector<bool> occupied(nVoxels.x * nVoxels.y * nVoxels.z, false);
+		for (int i = 0; i < scene.GetShapeCount(); ++i) {
+			BBox bbox = scene.GetShape(i)->WorldBBox();
+			Vector3i pMin = voxel(bbox.fmin), pMax = voxel(bbox.fmax);
+			for (int z = pMin.z; z <= pMax.z; ++z)
+				for (int y = pMin.y; y <= pMax.y; ++y)
+					for (int x = pMin.x; x <= pMax.x; ++x)
+						occupied[z * nVoxels.y * nVoxels.x + y * nVoxels.x + x] = true;
+		}
+
+		vector<Vector3f> centers;
+		for (int z = 0; z < nVoxels.z; ++z) {
+			for (int y = 0; y < nVoxels.y; ++y) {
+				for (int x = 0; x < nVoxels.x; ++x) {
+					if (!occupied[z * nVoxels.y * nVoxels.x + y * nVoxels.x + x]) continue;
+
+					//same mapping as voxel, so every center falls in its own voxel
+					centers.push_back(worldBBox.Lerp((Vector3f(x, y, z) + 0.5) / Vector3f(nVoxels.x, nVoxels.y, nVoxels.z)));
 				}
 			}
+		}
 
-			Float sum = 0;
-			for (int i = 0; i < distribution.size(); ++i)
-				sum += distribution[i];
+		//lookup computes and publishes distribution
+		Parallel::ParallelFor([&](int i) {
+			Lookup(centers[i]);
+			}, centers.size(), 16);
+	}
+
+	Distribution1D* SpatialLightDistribution::computeDistribution(const Vector3i& pi) const {
+		//calculate the bbox that the point p within. 
+		BBox worldBBox = scene.GetBBox();
+		Vector3f res = Vector3f(nVoxels.x, nVoxels.y, nVoxels.z);
+		Vector3f fmin = worldBBox.Lerp(Vector3f(pi.x, pi.y, pi.z) / res);
+		Vector3f fmax = worldBBox.Lerp(Vector3f(pi.x + 1, pi.y + 1, pi.z + 1) / res);
+		BBox voxelBBox = BBox(fmin, fmax);
+
+		// Compute the sampling distribution. Sample a number of points inside
+		// voxelBounds using a 3D Halton sequence; at each one, sample each
+		// light source and compute a weight based on Li/pdf for the light's
+		// sample (ignoring visibility between the point in the voxel and the
+		// point on the light source) as an approximation to how much the light
+		// is likely to contribute to illumination in the voxel.
+		const int nSamples = 128;
+		vector<Light*> lights = scene.GetLight();
+		vector<Float> distribution(lights.size(), Float(0));
+		for (int i = 0; i < nSamples; ++i) {
+			Vector3f p = voxelBBox.Lerp(Vector3f(RadicalInverse(0, i),
+				RadicalInverse(1, i), RadicalInverse(2, i)));
 			
-			Float avg = sum / (nSamples * distribution.size());
-			Float min = (avg > 0) ? .001 * avg : 1;
-			for (size_t i = 0; i < distribution.size(); ++i) {
-				distribution[i] = Max(distribution[i], min);
+			Intersection isect;
+			isect.p = p;
+
+			Vector2f u = Vector2f(RadicalInverse(3, i), RadicalInverse(4, i));
+			for (int j = 0; j < lights.size(); ++j) {
+				Light* light = lights[j];
+				Vector3f radiance;
+				Float pdf;
+				Ray shadowRay;
+				light->SampleLight(isect, u, radiance, pdf, shadowRay);
+				if (pdf != 0) {
+					Float scale = 1;
+					//if the point is occulded, then reduce contribution
+					if (scene.Occluded(shadowRay)) {
+						scale = 0.1;
+					}
+					distribution[j] += GetLuminance(radiance) / pdf * scale;
+				}
+			}
+		}
+
+		Float sum = 0;
+		for (int i = 0; i < distribution.size(); ++i)
+			sum += distribution[i];
+		
+		Float avg = sum / (nSamples * distribution.size());
+		Float min = (avg > 0) ? .001 * avg : 1;
+		for (size_t i = 0; i < distribution.size(); ++i) {
+			distribution[i] = Max(distribution[i], min);
+		}
+
+		return new Distribution1D(&distribution[0], distribution.size());
+	}
+
+	//cos(a - b) clamped to 1 if a < b
+	static __forceinline Float CosSubClamped(Float sinA, Float cosA, Float sinB, Float cosB) {
+		if (cosA > cosB) return 1;
+		return cosA * cosB + sinA * sinB;
+	}
+
+	//sin(a - b) clamped to 0 if a < b
+	static __forceinline Float SinSubClamped(Float sinA, Float cosA, Float sinB, Float cosB) {
+		if (cosA > cosB) return 0;
+		return sinA * cosB - cosA * sinB;
+	}
+
+	static __forceinline Float SafeSqrt(Float v) {
+		return sqrt(Max(Float(0), v));
+	}
+
+	//importance is given by
+	//    I = phi*cos(theta')*cos(thetaI')/d^2
+	//theta' is the minimum angle between emission cone and direction to p
+	//thetaI' is the minimum angle between normal of p and direction to bbox
+	Float LightBounds::Importance(const Vector3f& p, const Vector3f& n) const {
+		Vector3f pc = bbox.Center();
+		Float d2 = (p - pc).LengthSquare();
+		d2 = Max(d2, bbox.Diagonal().Length() * Float(0.5));
+
+		Vector3f wi = Normalize(p - pc);
+		Float cosThetaW = Dot(axis, wi);
+		Float sinThetaW = SafeSqrt(1 - cosThetaW * cosThetaW);
+
+		//angle subtended by bounding sphere
+		Vector3f center;
+		Float radius;
+		bbox.BoundingSphere(center, radius);
+		Float cosThetaB = -1;
+		if ((p - center).LengthSquare() > radius * radius) {
+			Float sin2ThetaB = radius * radius / (p - center).LengthSquare();
+			cosThetaB = SafeSqrt(1 - sin2ThetaB);
+		}
+		Float sinThetaB = SafeSqrt(1 - cosThetaB * cosThetaB);
+
+		//theta' = max(0, thetaW - thetaO - thetaB)
+		Float sinThetaO = SafeSqrt(1 - cosThetaO * cosThetaO);
+		Float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+		Float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+		Float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+		if (cosThetaP <= cosThetaE) return 0;
+
+		Float importance = phi * cosThetaP / d2;
+		if (n != Vector3f::Zero()) {
+			Float cosThetaI = fabs(Dot(wi, n));
+			Float sinThetaI = SafeSqrt(1 - cosThetaI * cosThetaI);
+			importance *= CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+		}
+
+		return Max(importance, Float(0));
+	}
+
+	//the smallest cone containing both cones
+	static void ConeUnion(const Vector3f& wa, Float cosA, const Vector3f& wb, Float cosB, Vector3f& w, Float& cosTheta) {
+		Float thetaA = acos(Clamp(cosA, Float(-1), Float(1)));
+		Float thetaB = acos(Clamp(cosB, Float(-1), Float(1)));
+		Float thetaD = acos(Clamp(Dot(wa, wb), Float(-1), Float(1)));
+		if (Min(Float(thetaD + thetaB), Float(PI)) <= thetaA) {
+			w = wa;
+			cosTheta = cosA;
+			return;
+		}
+		if (Min(Float(thetaD + thetaA), Float(PI)) <= thetaB) {
+			w = wb;
+			cosTheta = cosB;
+			return;
+		}
+
+		Float thetaO = (thetaA + thetaD + thetaB) * Float(0.5);
+		Vector3f wr = Cross(wa, wb);
+		if (thetaO >= PI || wr.LengthSquare() == 0) {
+			w = wa;
+			cosTheta = -1;
+			return;
+		}
+
+		//rotate wa toward wb by thetaO - thetaA
+		Float thetaR = thetaO - thetaA;
+		Vector3f k = Normalize(wr);
+		Float c = cos(thetaR), s = sin(thetaR);
+		w = Normalize(wa * c + Cross(k, wa) * s + k * Dot(k, wa) * (1 - c));
+		cosTheta = cos(thetaO);
+	}
+
+	LightBounds Union(const LightBounds& a, const LightBounds& b) {
+		if (a.phi == 0) return b;
+		if (b.phi == 0) return a;
+
+		LightBounds ret;
+		ret.bbox = a.bbox;
+		ret.bbox.Union(b.bbox);
+		ConeUnion(a.axis, a.cosThetaO, b.axis, b.cosThetaO, ret.axis, ret.cosThetaO);
+		ret.cosThetaE = Min(a.cosThetaE, b.cosThetaE);
+		ret.phi = a.phi + b.phi;
+
+		return ret;
+	}
+
+	//surface area orientation heuristic
+	static Float EvaluateCost(const LightBounds& b, const BBox& bounds, int dim) {
+		Float thetaO = acos(Clamp(b.cosThetaO, Float(-1), Float(1)));
+		Float thetaE = acos(Clamp(b.cosThetaE, Float(-1), Float(1)));
+		Float thetaW = Min(Float(thetaO + thetaE), Float(PI));
+		Float sinThetaO = SafeSqrt(1 - b.cosThetaO * b.cosThetaO);
+		Float mOmega = TWOPI * (1 - b.cosThetaO) +
+			PIOVER2 * (2 * thetaW * sinThetaO - cos(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO + b.cosThetaO);
+
+		//penalize long thin split
+		Vector3f diag = bounds.Diagonal();
+		Float kr = HMax(diag) / Max(diag[dim], Epsilon);
+		return b.phi * mOmega * kr * b.bbox.SurfaceArea();
+	}
+
+	LightBvhDistribution::LightBvhDistribution(const Scene& scene) {
+		vector<Light*> lights = scene.GetLight();
+		vector<pair<int, LightBounds>> bvhLights;
+		vector<Float> luminance;
+		luminance.reserve(lights.size());
+		bitTrails.resize(lights.size(), 0);
+		inBvh.resize(lights.size(), false);
+		for (int i = 0; i < lights.size(); ++i) {
+			const Light* light = lights[i];
+			luminance.push_back(light->Luminance());
+
+			LightBounds lb;
+			if (!light->GetBounds(lb.bbox, lb.axis, lb.cosThetaO, lb.cosThetaE)) {
+				infiniteLights.push_back(i);
+				continue;
+			}
+
+			//light without power can not be chosen
+			lb.phi = light->Luminance();
+			if (lb.phi <= 0) continue;
+
+			bvhLights.push_back(make_pair(i, lb));
+			inBvh[i] = true;
+		}
+		power = Distribution1D(&luminance[0], luminance.size());
+
+		if (bvhLights.size()) {
+			nodes.reserve(2 * bvhLights.size() - 1);
+			leafLights.reserve(bvhLights.size());
+			build(bvhLights, 0, bvhLights.size(), 0, 0);
+		}
+	}
+
+	int LightBvhDistribution::build(vector<pair<int, LightBounds>>& bvhLights, int start, int end, uint64_t bitTrail, int depth) {
+		//trail has one bit per level, so lights left at depth 63 share one leaf
+		if (end - start == 1 || depth >= 63) {
+			LightBounds bounds;
+			int nodeIdx = nodes.size();
+			int first = leafLights.size();
+			for (int i = start; i < end; ++i) {
+				int lightIdx = bvhLights[i].first;
+				bounds = Union(bounds, bvhLights[i].second);
+				leafLights.push_back(lightIdx);
+				bitTrails[lightIdx] = bitTrail;
+			}
+			nodes.push_back({ bounds, first, end - start, true });
+
+			return nodeIdx;
+		}
+
+		BBox bounds, centroidBounds;
+		for (int i = start; i < end; ++i) {
+			const BBox& bbox = bvhLights[i].second.bbox;
+			bounds.Union(bbox);
+			centroidBounds.Union(bbox.Center());
+		}
+
+		//choose split with minimum cost among buckets of three axes
+		const int nBuckets = 12;
+		Float minCost = INFINITY;
+		int minBucket = -1, minDim = -1;
+		Vector3f centroidDiag = centroidBounds.Diagonal();
+		for (int dim = 0; dim < 3; ++dim) {
+			if (centroidDiag[dim] == 0) continue;
+
+			LightBounds buckets[nBuckets];
+			for (int i = start; i < end; ++i) {
+				const LightBounds& lb = bvhLights[i].second;
+				int b = int(nBuckets * centroidBounds.Offset(lb.bbox.Center())[dim]);
+				b = Clamp(b, 0, nBuckets - 1);
+				buckets[b] = Union(buckets[b], lb);
+			}
+
+			for (int i = 0; i < nBuckets - 1; ++i) {
+				LightBounds below, above;
+				for (int j = 0; j <= i; ++j) below = Union(below, buckets[j]);
+				for (int j = i + 1; j < nBuckets; ++j) above = Union(above, buckets[j]);
+				if (below.phi == 0 || above.phi == 0) continue;
+
+				Float cost = EvaluateCost(below, bounds, dim) + EvaluateCost(above, bounds, dim);
+				if (cost > 0 && cost < minCost) {
+					minCost = cost;
+					minBucket = i;
+					minDim = dim;
+				}
+			}
+		}
+
+		int mid;
+		if (minDim == -1) {
+			mid = (start + end) / 2;
+		}
+		else {
+			auto it = partition(bvhLights.begin() + start, bvhLights.begin() + end, [&](const pair<int, LightBounds>& l) {
+				int b = int(nBuckets * centroidBounds.Offset(l.second.bbox.Center())[minDim]);
+				b = Clamp(b, 0, nBuckets - 1);
+				return b <= minBucket;
+				});
+			mid = it - bvhLights.begin();
+			if (mid == start || mid == end) mid = (start + end) / 2;
+		}
+
+		int nodeIdx = nodes.size();
+		nodes.push_back(Node());
+		int first = build(bvhLights, start, mid, bitTrail, depth + 1);
+		int second = build(bvhLights, mid, end, bitTrail | (uint64_t(1) << depth), depth + 1);
+		nodes[nodeIdx].bounds = Union(nodes[first].bounds, nodes[second].bounds);
+		nodes[nodeIdx].childOrLight = second;
+		nodes[nodeIdx].nLights = 0;
+		nodes[nodeIdx].isLeaf = false;
+
+		return nodeIdx;
+	}
+
+	const Distribution1D* LightBvhDistribution::Lookup(const Vector3f& p) const {
+		return &power;
+	}
+
+	//lights without bounds are chosen uniformly, and share the same probability as whole bvh
+	Float LightBvhDistribution::pInfinite() const {
+		int nInfinite = infiniteLights.size();
+		return Float(nInfinite) / (nInfinite + (nodes.empty() ? 0 : 1));
+	}
+
+	int LightBvhDistribution::Sample(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, Float u, Float& pdf) const {
+		Float pInf = pInfinite();
+		if (u < pInf) {
+			int nInfinite = infiniteLights.size();
+			int idx = Min(int(u / pInf * nInfinite), nInfinite - 1);
+			pdf = pInf / nInfinite;
+
+			return infiniteLights[idx];
+		}
+
+		if (nodes.empty()) {
+			pdf = 0;
+			return -1;
+		}
+
+		u = Min(Float((u - pInf) / (1 - pInf)), Float(0.99999994));
+		pdf = 1 - pInf;
+		int nodeIdx = 0;
+		while (true) {
+			const Node& node = nodes[nodeIdx];
+			if (node.isLeaf) {
+				if (node.bounds.Importance(p, n) > 0) {
+					//lights sharing a leaf are chosen uniformly
+					int idx = Min(int(u * node.nLights), node.nLights - 1);
+					pdf /= node.nLights;
+					return leafLights[node.childOrLight + idx];
+				}
+
+				pdf = 0;
+				return -1;
+			}
+
+			Float c0 = nodes[nodeIdx + 1].bounds.Importance(p, n);
+			Float c1 = nodes[node.childOrLight].bounds.Importance(p, n);
+			if (c0 == 0 && c1 == 0) {
+				pdf = 0;
+				return -1;
 			}
 
-			entries[index].distrib = Distribution1D(&distribution[0], distribution.size());
-			entries[index].valid = true;
-			return &entries[index].distrib;
+			//choose child and remap u
+			Float p0 = c0 / (c0 + c1);
+			if (u < p0) {
+				nodeIdx = nodeIdx + 1;
+				u = Min(Float(u / p0), Float(0.99999994));
+				pdf *= p0;
+			}
+			else {
+				nodeIdx = node.childOrLight;
+				u = Min(Float((u - p0) / (1 - p0)), Float(0.99999994));
+				pdf *= 1 - p0;
+			}
 		}
 	}
+
+	Float LightBvhDistribution::Pdf(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, int lightIdx) const {
+		if (lightIdx < 0) return 0;
+
+		Float pInf = pInfinite();
+		if (!inBvh[lightIdx]) {
+			for (int idx : infiniteLights) {
+				if (idx == lightIdx) return pInf / infiniteLights.size();
+			}
+
+			return 0;
+		}
+
+		uint64_t bitTrail = bitTrails[lightIdx];
+		Float pdf = 1 - pInf;
+		int nodeIdx = 0;
+		while (!nodes[nodeIdx].isLeaf) {
+			const Node& node = nodes[nodeIdx];
+			Float c0 = nodes[nodeIdx + 1].bounds.Importance(p, n);
+			Float c1 = nodes[node.childOrLight].bounds.Importance(p, n);
+			if (c0 == 0 && c1 == 0) return 0;
+
+			if (bitTrail & 1) {
+				pdf *= c1 / (c0 + c1);
+				nodeIdx = node.childOrLight;
+			}
+			else {
+				pdf *= c0 / (c0 + c1);
+				nodeIdx = nodeIdx + 1;
+			}
+			bitTrail >>= 1;
+		}
+
+		return pdf / nodes[nodeIdx].nLights;
+	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "../pol.h"
 #include "distribution.h"
+#include <atomic>
 
 namespace pol {
 	class Scene;
@@ -10,7 +11,13 @@ namespace pol {
 		LightDistribution();
 		virtual ~LightDistribution();
 
+		//distribution of shading point p, looked up once per shading point and
+		//passed to Sample and Pdf, so both use the same one for MIS
 		virtual const Distribution1D* Lookup(const Vector3f& p) const = 0;
+		//choose a light for shading point with normal n, n can be zero
+		//return -1 if no light is chosen
+		virtual int Sample(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, Float u, Float& pdf) const;
+		virtual Float Pdf(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, int lightIdx) const;
 	};
 
 	class UniformLightDistribution : public LightDistribution {
@@ -33,19 +40,85 @@ namespace pol {
 		virtual const Distribution1D* Lookup(const Vector3f& p) const;
 	};
 
+	//distributions of voxels are computed on demand and cached in a lock-free hash table
+	//only voxels that are looked up cost memory
 	class SpatialLightDistribution : public LightDistribution {
 	private:
 		const Scene& scene;
 		Vector3i nVoxels;
-		struct Entry {
-			bool valid = false;
-			Distribution1D distrib;
+		struct HashEntry {
+			//packed voxel coordinate, invalid if entry is empty
+			atomic<uint64_t> packedPos;
+			//published after computation
+			atomic<Distribution1D*> distribution;
 		};
-		mutable vector<Entry> entries;
+		mutable vector<HashEntry> hashTable;
+		//used while another thread is computing the voxel
+		Distribution1D fallback;
 
 	public:
 		SpatialLightDistribution(const Scene& scene, int maxVoxel = 64);
+		~SpatialLightDistribution();
 
 		virtual const Distribution1D* Lookup(const Vector3f& p) const;
+		//compute voxels overlapped by primitives in parallel
+		void Precompute();
+
+	private:
+		Vector3i voxel(const Vector3f& p) const;
+		Distribution1D* computeDistribution(const Vector3i& pi) const;
+	};
+
+	//bounds of a group of lights
+	struct LightBounds {
+		BBox bbox;
+		//cone bounding normals of lights
+		Vector3f axis;
+		Float cosThetaO;
+		//emission is bounded by thetaE around every normal
+		Float cosThetaE;
+		Float phi;
+
+		LightBounds() :axis(Vector3f::Up()), cosThetaO(1), cosThetaE(1), phi(0) {}
+
+		Float Importance(const Vector3f& p, const Vector3f& n) const;
+	};
+
+	LightBounds Union(const LightBounds& a, const LightBounds& b);
+
+	//light bvh, each node stores bounds, orientation cone and power of its lights
+	//traversal chooses child stochastically by importance to shading point
+	class LightBvhDistribution : public LightDistribution {
+	private:
+		struct Node {
+			LightBounds bounds;
+			//index of second child for interior node, first child is next to node
+			//index of first light in leafLights for leaf
+			int childOrLight;
+			//lights of leaf, more than one only when trail runs out of bits
+			int nLights;
+			bool isLeaf;
+		};
+
+		vector<Node> nodes;
+		vector<int> leafLights;
+		//lights without finite bounds, such as infinite and distant light
+		vector<int> infiniteLights;
+		//branch taken at each level from root to leaf of each light
+		vector<uint64_t> bitTrails;
+		vector<bool> inBvh;
+		//emission from light needs power distribution
+		Distribution1D power;
+
+	public:
+		LightBvhDistribution(const Scene& scene);
+
+		virtual const Distribution1D* Lookup(const Vector3f& p) const;
+		virtual int Sample(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, Float u, Float& pdf) const;
+		virtual Float Pdf(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, int lightIdx) const;
+
+	private:
+		int build(vector<pair<int, LightBounds>>& lights, int start, int end, uint64_t bitTrail, int depth);
+		Float pInfinite() const;
 	};
 }
\ No newline at end of file
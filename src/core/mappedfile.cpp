@@ -0,0 +1,53 @@
+#include "mappedfile.h"
+#include <Windows.h>
+
+namespace pol {
+	MappedFile::MappedFile()
+		:file(INVALID_HANDLE_VALUE), mapping(nullptr), data(nullptr), size(0) {
+
+	}
+
+	MappedFile::~MappedFile() {
+		Close();
+	}
+
+	bool MappedFile::Open(const string& filename) {
+		Close();
+
+		file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			Close();
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			Close();
+			return false;
+		}
+
+		data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data) {
+			Close();
+			return false;
+		}
+
+		size = fileSize.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+
+		file = INVALID_HANDLE_VALUE;
+		mapping = nullptr;
+		data = nullptr;
+		size = 0;
+	}
+}
\ No newline at end of file
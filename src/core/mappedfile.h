@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../pol.h"
+
+namespace pol {
+	//read only view of a whole file mapped into memory
+	//pages are loaded by the os on first touch, so opening is cheap
+	class MappedFile {
+	private:
+		void* file;
+		void* mapping;
+		const char* data;
+		int64_t size;
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const string& filename);
+		void Close();
+
+		const char* Data() const { return data; }
+		int64_t Size() const { return size; }
+	};
+}
\ No newline at end of file
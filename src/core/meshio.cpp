@@ -1,10 +1,12 @@
 #include "meshio.h"
+#include "mappedfile.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION // define this in only *one* .cc
 #include "tinyobjloader/tiny_obj_loader.h"
 
 #include <fstream>
 #include <string>
+#include <sys\stat.h>
 
 //https://github.com/kopaka1822/ObjWriter
 namespace objwriter
@@ -136,7 +138,51 @@ namespace objwriter
 }
 
 namespace pol {
-	void MeshIO::LoadModelFromFile(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, string filename, unsigned int flags) {
+	//layout of mesh cache file, sections of positions, normals, uvs and indices
+	//follow header in order, each starts at 16 bytes boundary, so they can be
+	//copied into vectors directly. cache is valid while size and modified time
+	//of model file and import flags are same
+	struct MeshCacheHeader {
+		char magic[4];
+		int version;
+		int64_t fileSize;
+		int64_t fileTime;
+		unsigned int flags;
+		int nPositions;
+		int nNormals;
+		int nUVs;
+		int nIndices;
+		int pad[3];
+	};
+
+	static const char meshCacheMagic[4] = { 'P', 'M', 'S', 'H' };
+	static const int meshCacheVersion = 1;
+
+	static __forceinline int64_t AlignSection(int64_t offset) {
+		return (offset + 15) & ~int64_t(15);
+	}
+
+	static bool FillCacheHeader(const string& filename, unsigned int flags, MeshCacheHeader& header) {
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0) return false;
+
+		memset(&header, 0, sizeof(MeshCacheHeader));
+		memcpy(header.magic, meshCacheMagic, 4);
+		header.version = meshCacheVersion;
+		header.fileSize = st.st_size;
+		header.fileTime = st.st_mtime;
+		header.flags = flags;
+		return true;
+	}
+
+	void MeshIO::LoadModelFromFile(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, string filename, unsigned int flags, bool cache) {
+		string cacheFile = filename + ".pmesh";
+		if (cache && loadCache(p, n, uv, indices, cacheFile, filename, flags)) {
+			fprintf(stdout, "Load Model from cache: %s\n", cacheFile.c_str());
+			fprintf(stdout, "Merge [%d] triangles\n", indices.size() / 3);
+			return;
+		}
+
 		int nPos = filename.find_last_of('.');
 		string extension = filename.substr(nPos + 1);
 		if (extension != ".obj") {
@@ -154,6 +200,74 @@ namespace pol {
 		}
 		fprintf(stdout, "Load Model sucessfully: %s\n", filename.c_str());
 		fprintf(stdout, "Merge [%d] triangles\n", indices.size() / 3);
+
+		if (cache) saveCache(p, n, uv, indices, cacheFile, filename, flags);
+	}
+
+	bool MeshIO::loadCache(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, const string& cacheFile, const string& filename, unsigned int flags) {
+		MeshCacheHeader expected;
+		if (!FillCacheHeader(filename, flags, expected)) return false;
+
+		MappedFile file;
+		if (!file.Open(cacheFile)) return false;
+		if (file.Size() < int64_t(sizeof(MeshCacheHeader))) return false;
+
+		MeshCacheHeader header;
+		memcpy(&header, file.Data(), sizeof(MeshCacheHeader));
+		if (memcmp(header.magic, expected.magic, 4) || header.version != expected.version ||
+			header.fileSize != expected.fileSize || header.fileTime != expected.fileTime || header.flags != expected.flags)
+			return false;
+
+		int64_t pOffset = AlignSection(sizeof(MeshCacheHeader));
+		int64_t nOffset = AlignSection(pOffset + int64_t(header.nPositions) * sizeof(Vector3f));
+		int64_t uvOffset = AlignSection(nOffset + int64_t(header.nNormals) * sizeof(Vector3f));
+		int64_t iOffset = AlignSection(uvOffset + int64_t(header.nUVs) * sizeof(Vector2f));
+		int64_t end = iOffset + int64_t(header.nIndices) * sizeof(int);
+		if (file.Size() < end) return false;
+
+		const char* data = file.Data();
+		p.resize(header.nPositions);
+		n.resize(header.nNormals);
+		uv.resize(header.nUVs);
+		indices.resize(header.nIndices);
+		if (header.nPositions) memcpy(&p[0], data + pOffset, header.nPositions * sizeof(Vector3f));
+		if (header.nNormals) memcpy(&n[0], data + nOffset, header.nNormals * sizeof(Vector3f));
+		if (header.nUVs) memcpy(&uv[0], data + uvOffset, header.nUVs * sizeof(Vector2f));
+		if (header.nIndices) memcpy(&indices[0], data + iOffset, header.nIndices * sizeof(int));
+
+		return true;
+	}
+
+	void MeshIO::saveCache(const vector<Vector3f>& p, const vector<Vector3f>& n, const vector<Vector2f>& uv, const vector<int>& indices, const string& cacheFile, const string& filename, unsigned int flags) {
+		MeshCacheHeader header;
+		if (!FillCacheHeader(filename, flags, header)) return;
+
+		header.nPositions = p.size();
+		header.nNormals = n.size();
+		header.nUVs = uv.size();
+		header.nIndices = indices.size();
+
+		ofstream out(cacheFile, ios::binary);
+		if (!out) {
+			fprintf(stderr, "Can not write mesh cache [%s]\n", cacheFile.c_str());
+			return;
+		}
+
+		int64_t offset = 0;
+		auto writeSection = [&](const void* src, int64_t bytes) {
+			static const char zeros[16] = { 0 };
+			int64_t aligned = AlignSection(offset);
+			out.write(zeros, aligned - offset);
+			if (bytes) out.write((const char*)src, bytes);
+			offset = aligned + bytes;
+		};
+
+		writeSection(&header, sizeof(MeshCacheHeader));
+		writeSection(p.data(), int64_t(p.size()) * sizeof(Vector3f));
+		writeSection(n.data(), int64_t(n.size()) * sizeof(Vector3f));
+		writeSection(uv.data(), int64_t(uv.size()) * sizeof(Vector2f));
+		writeSection(indices.data(), int64_t(indices.size()) * sizeof(int));
+		if (!out) fprintf(stderr, "Can not write mesh cache [%s]\n", cacheFile.c_str());
 	}
 
 	void MeshIO::WriteObj(const vector<Vector3f>& p, const vector<Vector3f>& n, const vector<Vector2f>& uv, const vector<int>& indices, string filename) {
@@ -11,10 +11,15 @@ using namespace Assimp;
 namespace pol {
 	class MeshIO {
 	public:
-		static void LoadModelFromFile(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, string filename, unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals);
+		//cache : model is stored to a binary file beside it on first load,
+		//which is mapped and copied section by section afterwards
+		static void LoadModelFromFile(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, string filename, unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals,
+			bool cache = true);
 		static void WriteObj(const vector<Vector3f>& p, const vector<Vector3f>& n, const vector<Vector2f>& uv, const vector<int>& indices, string filename);
 
 	private:
+		static bool loadCache(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, const string& cacheFile, const string& filename, unsigned int flags);
+		static void saveCache(const vector<Vector3f>& p, const vector<Vector3f>& n, const vector<Vector2f>& uv, const vector<int>& indices, const string& cacheFile, const string& filename, unsigned int flags);
 		static void loadObj(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, string filename);
 		static void processNode(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, aiNode* node, const aiScene* scene);
 		static void processMesh(vector<Vector3f>& p, vector<Vector3f>& n, vector<Vector2f>& uv, vector<int>& indices, aiMesh* aimesh, const aiScene* scene);
@@ -1,24 +1,91 @@
 #include "mipmap.h"
 #include "memory.h"
 #include "imageio.h"
+#include "texturecache.h"
+#include "parallel.h"
 
 namespace pol {
+	//conversion between float and half float with round to nearest even
+	//from Fabian Giesen, https://gist.github.com/rygorous/2156668
+	static uint16_t FloatToHalf(float value) {
+		const uint32_t f32infty = 255 << 23;
+		const uint32_t f16max = (127 + 16) << 23;
+		const uint32_t denormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+		uint32_t u;
+		memcpy(&u, &value, sizeof(float));
+		uint32_t sign = u & 0x80000000u;
+		u ^= sign;
+
+		uint16_t o;
+		if (u >= f16max) {
+			//inf or nan
+			o = u > f32infty ? 0x7e00 : 0x7c00;
+		}
+		else if (u < (113 << 23)) {
+			//denormal, let float addition do rounding
+			float f, magic;
+			memcpy(&f, &u, sizeof(float));
+			memcpy(&magic, &denormMagic, sizeof(float));
+			f += magic;
+			memcpy(&u, &f, sizeof(float));
+			o = uint16_t(u - denormMagic);
+		}
+		else {
+			uint32_t mantOdd = (u >> 13) & 1;
+			u += (uint32_t(15 - 127) << 23) + 0xfff;
+			u += mantOdd;
+			o = uint16_t(u >> 13);
+		}
+
+		return o | uint16_t(sign >> 16);
+	}
+
+	static __forceinline unsigned char EncodeByte(Float value, bool srgb) {
+		value = Clamp(value, Float(0), Float(1));
+		if (srgb) value = pow(value, Float(1 / 2.2));
+
+		return (unsigned char)(value * 255 + Float(0.5));
+	}
+
+	//gaussian weights of ewa filter indexed by squared radius in [0, 1]
+	//the filter is offset so that weight falls to zero at edge of ellipse
+	static const int ewaLUTSize = 128;
+	static Float* CreateEwaLUT() {
+		static Float lut[ewaLUTSize];
+		const Float alpha = 2;
+		for (int i = 0; i < ewaLUTSize; ++i) {
+			Float r2 = Float(i) / Float(ewaLUTSize - 1);
+			lut[i] = exp(-alpha * r2) - exp(-alpha);
+		}
+
+		return lut;
+	}
+	static const Float* ewaLUT = CreateEwaLUT();
+
 	Mipmap::Mipmap() {
 		fmode = FilterMode::E_TRILINEAR;
 		wmode = WrapMode::E_REPEAT;
+		format = TexelFormat::E_RGB32F;
+		srgb = false;
+		decodeTable = ImageIO::GetDecodeTable(srgb);
+		tiled = nullptr;
+		maxAnisotropy = 8;
 	}
 
-	Mipmap::Mipmap(int w, int h, const vector<Vector3f>& data, FilterMode fmode, WrapMode wmode) {
-		Build(w, h, data, fmode, wmode);
+	Mipmap::Mipmap(int w, int h, const vector<Vector3f>& data, FilterMode fmode, WrapMode wmode, TexelFormat format, bool srgb) {
+		tiled = nullptr;
+		maxAnisotropy = 8;
+		Build(w, h, data, fmode, wmode, format, srgb);
 	}
 
 	Mipmap::~Mipmap() {
-		for (int i = 0; i < PyramidCount(); ++i)
-			FreeAligned(pyramid[i].data);
+		for (TexInfo& ti : pyramid)
+			FreeAligned(ti.data);
+		delete tiled;
 	}
 
 	int Mipmap::PyramidCount() const {
-		if (fmode != FilterMode::E_TRILINEAR) return 1;
+		//only one level is built for nearst and linear filter
 		return pyramid.size();
 	}
 
@@ -26,89 +93,207 @@ namespace pol {
 		return pyramid;
 	}
 
-	void Mipmap::Build(int w, int h, const vector<Vector3f>& data, FilterMode fmode, WrapMode wmode) {
-		this->fmode = fmode;
-		this->wmode = wmode;
-
-		int nLevel = Log2Int(Max(w, h)) + 1;
-		pyramid.resize(nLevel);
-		pyramid[0].w = w;
-		pyramid[0].h = h;
-		pyramid[0].data = AllocAligned<Vector3f>(w * h);
-		for (int i = 0; i < w * h; ++i)
-			pyramid[0].data[i] = data[i];
+	int Mipmap::TexelSize(TexelFormat format) {
+		switch (format) {
+		case TexelFormat::E_RGB16F: return 3 * sizeof(uint16_t);
+		case TexelFormat::E_RGB8: return 3;
+		case TexelFormat::E_R8: return 1;
+		case TexelFormat::E_RGB32F:
+		default: return sizeof(Vector3f);
+		}
+	}
 
-		//does not need generate mipmap if the trilinear filter does not choice
-		if (fmode < FilterMode::E_TRILINEAR) return;
+	void Mipmap::EncodeTexels(TexelFormat format, bool srgb, const Vector3f* in, int count, unsigned char* out) {
+		for (int i = 0; i < count; ++i) {
+			const Vector3f& c = in[i];
+			switch (format) {
+			case TexelFormat::E_RGB32F:
+				memcpy(out + i * sizeof(Vector3f), &c, sizeof(Vector3f));
+				break;
+			case TexelFormat::E_RGB16F: {
+				//values beyond largest finite half would become inf,
+				//which turns radiance and light pdf into inf or nan
+				const float halfMax = 65504.f;
+				uint16_t* p = (uint16_t*)out + 3 * i;
+				p[0] = FloatToHalf(Clamp(float(c.X()), -halfMax, halfMax));
+				p[1] = FloatToHalf(Clamp(float(c.Y()), -halfMax, halfMax));
+				p[2] = FloatToHalf(Clamp(float(c.Z()), -halfMax, halfMax));
+				break;
+			}
+			case TexelFormat::E_RGB8: {
+				unsigned char* p = out + 3 * i;
+				p[0] = EncodeByte(c.X(), srgb);
+				p[1] = EncodeByte(c.Y(), srgb);
+				p[2] = EncodeByte(c.Z(), srgb);
+				break;
+			}
+			case TexelFormat::E_R8:
+				out[i] = EncodeByte(GetLuminance(c), srgb);
+				break;
+			}
+		}
+	}
 
-		for (int level = 1; level < nLevel; ++level) {
-			int prevW = pyramid[level - 1].w;
-			int prevH = pyramid[level - 1].h;
-			int nextW = prevW == 1 ? 1 : floor(prevW >> 1);
-			int nextH = prevH == 1 ? 1 : floor(prevH >> 1);
-			pyramid[level].w = nextW;
-			pyramid[level].h = nextH;
-			pyramid[level].data = AllocAligned<Vector3f>(nextW * nextH);
-
-			vector<Vector3f> temp(prevH * nextW);
-			for (int i = 0; i < prevH; ++i) {
-				for (int j = 0; j < nextW; ++j) {
-					Float denominator = 2 * nextW + 1;
-					Float weight1 = Float(nextW - j) / denominator;
-					Float weight2 = Float(nextW) / denominator;
-					Float weight3 = Float(1 + j) / denominator;
-
-					//when prevW == 1
-					//the x1 = 0, x2 = 0, x3 = 0
-					int x1 = 2 * j;
-					int x2 = prevW == 1 ? 0 : 2 * j + 1;
-					int x3 = j + 1 == nextW ? x2 : 2 * j + 2;
-					int idx1 = i * prevW + x1;
-					int idx2 = i * prevW + x2;
-					int idx3 = i * prevW + x3;
-					Vector3f average = weight1 * pyramid[level - 1].data[idx1]
-						+ weight2 * pyramid[level - 1].data[idx2]
-						+ weight3 * pyramid[level - 1].data[idx3];
-
-					temp[i * nextW + j] = average;
-				}
+	void Mipmap::Downsample(int w, int h, const vector<Vector3f>& in, int& nextW, int& nextH, vector<Vector3f>& out) {
+		int prevW = w, prevH = h;
+		nextW = prevW == 1 ? 1 : floor(prevW >> 1);
+		nextH = prevH == 1 ? 1 : floor(prevH >> 1);
+		out.resize(nextW * nextH);
+
+		//rows of both passes are independent
+		vector<Vector3f> temp(prevH * nextW);
+		Parallel::ParallelFor([&](int i) {
+			for (int j = 0; j < nextW; ++j) {
+				Float denominator = 2 * nextW + 1;
+				Float weight1 = Float(nextW - j) / denominator;
+				Float weight2 = Float(nextW) / denominator;
+				Float weight3 = Float(1 + j) / denominator;
+
+				//when prevW == 1
+				//the x1 = 0, x2 = 0, x3 = 0
+				int x1 = 2 * j;
+				int x2 = prevW == 1 ? 0 : 2 * j + 1;
+				int x3 = j + 1 == nextW ? x2 : 2 * j + 2;
+				int idx1 = i * prevW + x1;
+				int idx2 = i * prevW + x2;
+				int idx3 = i * prevW + x3;
+				Vector3f average = weight1 * in[idx1]
+					+ weight2 * in[idx2]
+					+ weight3 * in[idx3];
+
+				temp[i * nextW + j] = average;
 			}
+			}, prevH, 32);
 
+		Parallel::ParallelFor([&](int j) {
 			for (int i = 0; i < nextW; ++i) {
-				for (int j = 0; j < nextH; ++j) {
-					Float denominator = 2 * nextH + 1;
-					Float weight1 = Float(nextH - j) / denominator;
-					Float weight2 = Float(nextH) / denominator;
-					Float weight3 = Float(1 + j) / denominator;
-
-					//when prevH == 1
-					//the x1 = 0, x2 = 0, x3 = 0
-					int x1 = 2 * j;
-					int x2 = prevH == 1 ? 0 : 2 * j + 1;
-					int x3 = j + 1 == nextH ? x2 : 2 * j + 2;
-					int idx1 = x1 * nextW + i;
-					int idx2 = x2 * nextW + i;
-					int idx3 = x3 * nextW + i;
-					Vector3f average = weight1 * temp[idx1]
-						+ weight2 * temp[idx2]
-						+ weight3 * temp[idx3];
-
-
-					pyramid[level].data[j * nextW + i] = average;
+				Float denominator = 2 * nextH + 1;
+				Float weight1 = Float(nextH - j) / denominator;
+				Float weight2 = Float(nextH) / denominator;
+				Float weight3 = Float(1 + j) / denominator;
+
+				//when prevH == 1
+				//the x1 = 0, x2 = 0, x3 = 0
+				int x1 = 2 * j;
+				int x2 = prevH == 1 ? 0 : 2 * j + 1;
+				int x3 = j + 1 == nextH ? x2 : 2 * j + 2;
+				int idx1 = x1 * nextW + i;
+				int idx2 = x2 * nextW + i;
+				int idx3 = x3 * nextW + i;
+				Vector3f average = weight1 * temp[idx1]
+					+ weight2 * temp[idx2]
+					+ weight3 * temp[idx3];
+
+
+				out[j * nextW + i] = average;
+			}
+			}, nextH, 32);
+	}
+
+	TexInfo Mipmap::createLevel(int w, int h, const Vector3f* data) const {
+		int blockSize = 1 << logBlockSize;
+		int blockTexels = blockSize * blockSize;
+		int blockBytes = blockTexels * TexelSize(format);
+		int vBlocks = (h + blockSize - 1) >> logBlockSize;
+		TexInfo ti;
+		ti.w = w;
+		ti.h = h;
+		ti.uBlocks = (w + blockSize - 1) >> logBlockSize;
+		ti.data = AllocAligned<unsigned char>(ti.uBlocks * vBlocks * blockBytes);
+
+		//texels out of image in border blocks are never read, replicate edge texels for them
+		Parallel::ParallelFor([&](int by) {
+			vector<Vector3f> block(blockTexels);
+			for (int bx = 0; bx < ti.uBlocks; ++bx) {
+				for (int y = 0; y < blockSize; ++y) {
+					int py = Min((by << logBlockSize) + y, h - 1);
+					for (int x = 0; x < blockSize; ++x) {
+						int px = Min((bx << logBlockSize) + x, w - 1);
+						block[(y << logBlockSize) + x] = data[py * w + px];
+					}
 				}
+
+				EncodeTexels(format, srgb, &block[0], blockTexels, ti.data + (by * ti.uBlocks + bx) * blockBytes);
 			}
+			}, vBlocks, 8);
+
+		return ti;
+	}
+
+	__forceinline Vector3f Mipmap::texel(int level, int x, int y) const {
+		if (tiled) return tiled->Texel(level, x, y);
+
+		const TexInfo& ti = pyramid[level];
+		int mask = (1 << logBlockSize) - 1;
+		int block = (y >> logBlockSize) * ti.uBlocks + (x >> logBlockSize);
+		int offset = (block << (2 * logBlockSize)) + ((y & mask) << logBlockSize) + (x & mask);
+		return DecodeTexel(format, decodeTable, ti.data + offset * TexelSize(format));
+	}
+
+	void Mipmap::Build(int w, int h, const vector<Vector3f>& data, FilterMode fmode, WrapMode wmode, TexelFormat format, bool srgb) {
+		this->fmode = fmode;
+		this->wmode = wmode;
+		this->format = format;
+		this->srgb = srgb;
+		decodeTable = ImageIO::GetDecodeTable(srgb);
+
+		//does not need generate mipmap if the trilinear filter does not choice
+		int nLevel = fmode < FilterMode::E_TRILINEAR ? 1 : LevelCount(w, h);
+		pyramid.resize(nLevel);
+		pyramid[0] = createLevel(w, h, &data[0]);
+
+		//levels are filtered from full precision of previous level,
+		//so quantization error of compact formats is not accumulated
+		vector<Vector3f> prev, next;
+		int prevW = w, prevH = h;
+		for (int level = 1; level < nLevel; ++level) {
+			int nextW, nextH;
+			Downsample(prevW, prevH, level == 1 ? data : prev, nextW, nextH, next);
+			pyramid[level] = createLevel(nextW, nextH, &next[0]);
+			prev.swap(next);
+			prevW = nextW;
+			prevH = nextH;
 		}
 	}
 
+	bool Mipmap::BuildTiled(const string& file, bool srgb, bool flip, FilterMode fmode, WrapMode wmode, TexelFormat format) {
+		this->fmode = fmode;
+		this->wmode = wmode;
+		this->format = format;
+		this->srgb = srgb;
+		decodeTable = ImageIO::GetDecodeTable(srgb);
+
+		tiled = new TiledImage();
+		if (!tiled->Open(file, srgb, flip, format)) {
+			delete tiled;
+			tiled = nullptr;
+			return false;
+		}
+
+		//levels only hold size, texels live in tiles
+		int nLevel = fmode < FilterMode::E_TRILINEAR ? 1 : tiled->LevelCount();
+		pyramid.resize(nLevel);
+		for (int i = 0; i < nLevel; ++i) {
+			pyramid[i].w = tiled->Width(i);
+			pyramid[i].h = tiled->Height(i);
+			pyramid[i].uBlocks = 0;
+			pyramid[i].data = nullptr;
+		}
+
+		return true;
+	}
+
 	Vector3f Mipmap::Lookup(const Vector2f& uv, Float width) const {
+		//tiles fetched during lookup stay alive until pin is released
+		TextureCache::Pin pin(tiled != nullptr);
 		Vector3f color;
 		switch (fmode) {
 		case FilterMode::E_NEARST: {
-			TexInfo ti = pyramid[0];
+			const TexInfo& ti = pyramid[0];
 			int x = (ti.w - 1) * uv.x;
 			int y = (ti.h - 1) * uv.y;
 
-			color = ti.data[y * ti.w + x];
+			color = texel(0, x, y);
 			break;
 		}
 		case FilterMode::E_LINEAR: {
@@ -143,6 +328,7 @@ namespace pol {
 	}
 
 	Vector3f Mipmap::Lookup(const Intersection& isect) const {
+		TextureCache::Pin pin(tiled != nullptr);
 		Vector2f uv = getTexCoordinate(isect.uv);
 		if (fmode != FilterMode::E_EWA) {
 		Trilinear:
@@ -164,8 +350,18 @@ namespace pol {
 			goto Trilinear;
 		}
 
+		//widen minor axis of eccentric ellipse, which is blurrier but
+		//selects coarser level, so texels visited are bounded
+		if (minorLength * maxAnisotropy < majorLength) {
+			Float scale = majorLength / (minorLength * maxAnisotropy);
+			d2 = d2 * scale;
+			minorLength *= scale;
+		}
+
 		Float lod = Max(Float(0), PyramidCount() - Float(1) + Log2(minorLength));
 		int ilod = floor(lod);
+		if (ilod >= PyramidCount() - 1) return texel(PyramidCount() - 1, 0, 0);
+
 		return Lerp(ewa(ilod, uv, d1, d2), ewa(ilod + 1, uv, d1, d2), lod - ilod);
 	}
 
@@ -192,69 +388,116 @@ namespace pol {
 	}
 
 	Vector3f Mipmap::triangle(int level, const Vector2f& uv) const {
-		TexInfo ti = pyramid[level];
+		const TexInfo& ti = pyramid[level];
 		int x = (ti.w - 1) * uv.x;
 		int y = (ti.h - 1) * uv.y;
 		int nextX = Clamp(x + 1, 0, ti.w - 1);
 		int nextY = Clamp(y + 1, 0, ti.h - 1);
 		Float dx = (ti.w - 1) * uv.x - x;
 		Float dy = (ti.h - 1) * uv.y - y;
-		return (1 - dy) * (1 - dx) * ti.data[y * ti.w + x]
-		 	 + (1 - dy) * dx * ti.data[y * ti.w + nextX]
-			 + dy * (1 - dx) * ti.data[nextY * ti.w + x]
-			 + dy * dx * ti.data[nextY * ti.w + nextX];
+		return (1 - dy) * (1 - dx) * texel(level, x, y)
+		 	 + (1 - dy) * dx * texel(level, nextX, y)
+			 + dy * (1 - dx) * texel(level, x, nextY)
+			 + dy * dx * texel(level, nextX, nextY);
 	}
 
 
+	Vector3f Mipmap::wrapTexel(int level, int x, int y) const {
+		const TexInfo& ti = pyramid[level];
+		switch (wmode) {
+		case WrapMode::E_REPEAT:
+			x = x % ti.w;
+			y = y % ti.h;
+			if (x < 0) x += ti.w;
+			if (y < 0) y += ti.h;
+			break;
+		case WrapMode::E_CLAMP:
+			x = Clamp(x, 0, ti.w - 1);
+			y = Clamp(y, 0, ti.h - 1);
+			break;
+		case WrapMode::E_MIRROR: {
+			//reflect across edges, period is twice of size
+			int px = x % (2 * ti.w), py = y % (2 * ti.h);
+			if (px < 0) px += 2 * ti.w;
+			if (py < 0) py += 2 * ti.h;
+			x = px < ti.w ? px : 2 * ti.w - 1 - px;
+			y = py < ti.h ? py : 2 * ti.h - 1 - py;
+			break;
+		}
+		}
+
+		return texel(level, x, y);
+	}
+
+	//elliptically weighted average, Heckbert 1989
+	//implicit ellipse e(s,t) = A*s*s + B*s*t + C*t*t < 1 is computed in texel
+	//space of the level, so no trigonometric function is needed
 	Vector3f Mipmap::ewa(int level, const Vector2f& uv, const Vector2f& duvx, const Vector2f& duvy) const {
-		TexInfo ti = pyramid[level];
-
-		Float APrime = duvx.y * duvx.y + duvy.y * duvy.y;
-		Float BPrime = -2 * (duvx.x * duvx.y + duvy.x * duvy.y);
-		Float CPrime = duvx.x * duvx.x + duvy.x * duvy.x;
-		Float t = (duvx.x * duvy.y - duvy.x * duvx.y);
-		Float F = 1 / (t * t);
-		APrime *= F;
-		BPrime *= F;
-		CPrime *= F;
-		Float theta = atan(BPrime / (APrime - CPrime)) * 0.5;
-		Float costheta = cos(theta);
-		Float sintheta = sin(theta);
-		Float det = (APrime - CPrime) * (APrime - CPrime) + BPrime * BPrime;
-		Float A = 0.5 * (APrime + CPrime - sqrt(det));
-		Float C = 0.5 * (APrime + CPrime + sqrt(det));
-		Float a = 1 / sqrt(A);
-		Float b = 1 / sqrt(C);
-		Float x = Max(a * costheta, b * sintheta);
-		Float y = Max(a * sintheta, b * costheta);
-		int ss = floor(uv.x * ti.w);
-		int tt = floor(uv.y * ti.h);
-		int xx = floor(x * ti.w);
-		int yy = floor(y * ti.h);
+		const TexInfo& ti = pyramid[level];
+		Float s = uv.x * ti.w - Float(0.5);
+		Float t = uv.y * ti.h - Float(0.5);
+		Float dsx = duvx.x * ti.w, dtx = duvx.y * ti.h;
+		Float dsy = duvy.x * ti.w, dty = duvy.y * ti.h;
+
+		//one is added to make sure ellipse covers at least one texel
+		Float A = dtx * dtx + dty * dty + 1;
+		Float B = -2 * (dsx * dtx + dsy * dty);
+		Float C = dsx * dsx + dsy * dsy + 1;
+		Float invF = 1 / (A * C - B * B * Float(0.25));
+		A *= invF;
+		B *= invF;
+		C *= invF;
+
+		//bounding box of ellipse
+		Float det = -B * B + 4 * A * C;
+		Float invDet = 1 / det;
+		Float uSqrt = sqrt(det * C), vSqrt = sqrt(A * det);
+		int s0 = ceil(s - 2 * invDet * uSqrt);
+		int s1 = floor(s + 2 * invDet * uSqrt);
+		int t0 = ceil(t - 2 * invDet * vSqrt);
+		int t1 = floor(t + 2 * invDet * vSqrt);
+
 		Vector3f sum = 0;
 		Float sumWeights = 0;
-		for (int i = -xx + ss; i <= xx + ss; i++) {
-			if (i < 0 || i >= ti.w) continue;
-			for (int j = -yy + tt; j <= yy + tt; j++) {
-				if (j < 0 || j >= ti.h) continue;
-				Float s = Float(i - ss) / ti.w;
-				Float t = Float(j - tt) / ti.h;
-				Float r2 = APrime * s * s + BPrime * s * t + CPrime * t * t;
+		for (int it = t0; it <= t1; ++it) {
+			Float tt = it - t;
+			for (int is = s0; is <= s1; ++is) {
+				Float ss = is - s;
+				Float r2 = A * ss * ss + B * ss * tt + C * tt * tt;
 				if (r2 < 1) {
-					Float weight = 1;// exp(-2 * r2) - exp(-2);
-					sum += ti.data[j * ti.w + i] * weight;
+					int index = Min(int(r2 * ewaLUTSize), ewaLUTSize - 1);
+					Float weight = ewaLUT[index];
+					sum += wrapTexel(level, is, it) * weight;
 					sumWeights += weight;
 				}
 			}
 		}
 
-		return sum /= sumWeights;
+		if (sumWeights <= 0) return triangle(level, uv);
+
+		return sum / sumWeights;
+	}
+
+	void Mipmap::GetLevel(int level, int& w, int& h, vector<Vector3f>& data) const {
+		TextureCache::Pin pin(tiled != nullptr);
+		const TexInfo& ti = pyramid[level];
+		w = ti.w;
+		h = ti.h;
+		data.resize(w * h);
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				data[y * w + x] = texel(level, x, y);
+			}
+		}
 	}
 
 	void Mipmap::WritePyramid(const string& directory) const {
 		for (int i = 0; i < PyramidCount(); ++i) {
 			string file = directory + "/" + to_string(i) + ".png";
-			ImageIO::SavePng(file.c_str(), pyramid[i].w, pyramid[i].h, pyramid[i].data);
+			int w, h;
+			vector<Vector3f> data;
+			GetLevel(i, w, h, data);
+			ImageIO::SavePng(file.c_str(), w, h, data);
 		}
 	}
 
@@ -268,7 +511,15 @@ namespace pol {
 		static map<FilterMode, string> fmstring = {
 			pair<FilterMode, string>(FilterMode::E_NEARST, "nearst"),
 			pair<FilterMode, string>(FilterMode::E_LINEAR, "linear"),
-			pair<FilterMode, string>(FilterMode::E_TRILINEAR, "trilinear")
+			pair<FilterMode, string>(FilterMode::E_TRILINEAR, "trilinear"),
+			pair<FilterMode, string>(FilterMode::E_EWA, "ewa")
+		};
+
+		static map<TexelFormat, string> tfstring = {
+			pair<TexelFormat, string>(TexelFormat::E_RGB32F, "float"),
+			pair<TexelFormat, string>(TexelFormat::E_RGB16F, "half"),
+			pair<TexelFormat, string>(TexelFormat::E_RGB8, "rgb8"),
+			pair<TexelFormat, string>(TexelFormat::E_R8, "r8")
 		};
 
 		string ret;
@@ -277,6 +528,8 @@ namespace pol {
 			+ ",\n  pyramid count = " + to_string(PyramidCount())
 			+ ",\n  wrap mode = " + wmstring[wmode]
 			+ ",\n  filter mode = " + fmstring[fmode]
+			+ ",\n  texel format = " + tfstring[format]
+			+ ",\n  tiled = " + (tiled ? "true" : "false")
 			+ "\n]";
 
 		return ret;
@@ -2,6 +2,7 @@
 
 #include "../pol.h"
 #include "intersection.h"
+#include <cstring>
 
 namespace pol {
 	//non power of 2 mipmap generation
@@ -37,32 +38,115 @@ namespace pol {
 		E_EWA,
 	};
 
+	//storage of texels, all formats are decoded to linear rgb on lookup
+	//8-bit formats keep srgb encoding if texture is srgb, so 8-bit
+	//source images are stored without loss
+	enum class TexelFormat {
+		E_RGB32F,
+		E_RGB16F, //half float, for hdr images
+		E_RGB8,
+		E_R8, //single channel, for masks and gray images
+	};
+
+	//texels are stored in blocked layout same as BlockedArray in memory.h,
+	//each 4x4 block is contiguous, so filter footprints touch fewer cache lines
 	struct TexInfo {
 		int w, h;
-		Vector3f* data;
+		//number of blocks in a row
+		int uBlocks;
+		//texels in format of mipmap
+		unsigned char* data;
 	};
+
+	class TiledImage;
 	class Mipmap {
 	private:
 		vector<TexInfo> pyramid;
 		WrapMode wmode;
 		FilterMode fmode;
+		TexelFormat format;
+		bool srgb;
+		//8-bit to linear table
+		const float* decodeTable;
+		//texels are paged from tiled cache file if not null
+		TiledImage* tiled;
+		//ratio of major to minor axis of ewa footprint is clamped to this,
+		//which bounds number of texels visited by ewa
+		Float maxAnisotropy;
 		
 	public:
 		Mipmap();
-		Mipmap(int w, int h, const vector<Vector3f>& data, FilterMode fmode = FilterMode::E_TRILINEAR, WrapMode wmode = WrapMode::E_REPEAT);
+		Mipmap(int w, int h, const vector<Vector3f>& data, FilterMode fmode = FilterMode::E_TRILINEAR, WrapMode wmode = WrapMode::E_REPEAT,
+			TexelFormat format = TexelFormat::E_RGB32F, bool srgb = false);
 		~Mipmap();
 
 		int PyramidCount() const;
+		void SetMaxAnisotropy(Float a) { maxAnisotropy = a; }
 		vector<TexInfo> GetPyramid() const;
-		void Build(int w, int h, const vector<Vector3f>& data, FilterMode fmode = FilterMode::E_TRILINEAR, WrapMode wmode = WrapMode::E_REPEAT);
+		void Build(int w, int h, const vector<Vector3f>& data, FilterMode fmode = FilterMode::E_TRILINEAR, WrapMode wmode = WrapMode::E_REPEAT,
+			TexelFormat format = TexelFormat::E_RGB32F, bool srgb = false);
+		//levels are kept in a tiled cache file and paged in by TextureCache
+		bool BuildTiled(const string& file, bool srgb, bool flip, FilterMode fmode = FilterMode::E_TRILINEAR, WrapMode wmode = WrapMode::E_REPEAT,
+			TexelFormat format = TexelFormat::E_RGB8);
 		Vector3f Lookup(const Vector2f& uv, Float width = 0) const;
 		Vector3f Lookup(const Intersection& isect) const;
 
+		//decode texels of level in row order
+		void GetLevel(int level, int& w, int& h, vector<Vector3f>& data) const;
 		//debug purpose
 		void WritePyramid(const string& directory) const;
 		string ToString() const;
 
+		static int TexelSize(TexelFormat format);
+		static void EncodeTexels(TexelFormat format, bool srgb, const Vector3f* in, int count, unsigned char* out);
+		static __forceinline Vector3f DecodeTexel(TexelFormat format, const float* decodeTable, const unsigned char* p) {
+			switch (format) {
+			case TexelFormat::E_RGB16F: {
+				const uint16_t* h = (const uint16_t*)p;
+				return Vector3f(halfToFloat(h[0]), halfToFloat(h[1]), halfToFloat(h[2]));
+			}
+			case TexelFormat::E_RGB8:
+				return Vector3f(decodeTable[p[0]], decodeTable[p[1]], decodeTable[p[2]]);
+			case TexelFormat::E_R8:
+				return Vector3f(decodeTable[p[0]]);
+			case TexelFormat::E_RGB32F:
+			default:
+				return *(const Vector3f*)p;
+			}
+		}
+		static int LevelCount(int w, int h) { return Log2Int(Max(w, h)) + 1; }
+		static const int logBlockSize = 2;
+		//filter level to next level by rounding down rule
+		static void Downsample(int w, int h, const vector<Vector3f>& in, int& nextW, int& nextH, vector<Vector3f>& out);
+
 	private:
+		TexInfo createLevel(int w, int h, const Vector3f* data) const;
+		__forceinline Vector3f texel(int level, int x, int y) const;
+		//apply wrap mode to texel coordinate out of level
+		Vector3f wrapTexel(int level, int x, int y) const;
+		static __forceinline float halfToFloat(uint16_t h) {
+			//magic number method of Fabian Giesen
+			const uint32_t shiftedExp = 0x7c00 << 13;
+			uint32_t o = (h & 0x7fff) << 13;
+			uint32_t exp = shiftedExp & o;
+			o += (127 - 15) << 23;
+			float f;
+			if (exp == shiftedExp) {
+				//inf or nan
+				o += (128 - 16) << 23;
+			}
+			else if (exp == 0) {
+				//denormal, renormalize by float subtraction
+				o += 1 << 23;
+				memcpy(&f, &o, sizeof(float));
+				f -= 6.10351562e-05f;
+				memcpy(&o, &f, sizeof(float));
+			}
+
+			o |= uint32_t(h & 0x8000) << 16;
+			memcpy(&f, &o, sizeof(float));
+			return f;
+		}
 		Vector2f getTexCoordinate(const Vector2f& uv) const;
 		Vector3f triangle(int level, const Vector2f& uv) const;
 		Vector3f ewa(int level, const Vector2f& uv, const Vector2f& d1, const Vector2f& d2) const;
@@ -93,14 +93,21 @@ namespace pol {
 	atomic<int> nextTaskId = 0;
 	queue<RenderBlock> tasks;
 	function<void(const RenderBlock & rb)> func;
+	//only rendering loop reports progress
+	bool reportProgress = true;
+	//index of working thread, -1 means not a working thread
+	thread_local int threadIndex = -1;
+	thread_local bool backgroundThread = false;
 	void ThreadEntry(int index) {
+		threadIndex = index;
 		while (true) {
 			taskBarrier.lock();
 			if (tasks.empty()) {
 				taskBarrier.unlock();
 				continue;
 			}
-			const RenderBlock& rb = tasks.front();
+			//copy the block, the reference is invalid after pop
+			RenderBlock rb = tasks.front();
 			tasks.pop();
 			taskBarrier.unlock();
 			activeThreads++;
@@ -109,14 +116,19 @@ namespace pol {
 
 			activeThreads--;
 			nextTaskId++;
-			reportBarrier.lock();
-			printf("Rendering Progress[%.3f%%]\r", Float(nTasks - 1 - tasks.size()) / (nTasks - 1) * 100);
-			reportBarrier.unlock();
+			if (reportProgress) {
+				reportBarrier.lock();
+				printf("Rendering Progress[%.3f%%]\r", Float(nextTaskId) / nTasks * 100);
+				reportBarrier.unlock();
+			}
 		}
 
 	}
 
 	void Parallel::Startup() {
+		//already started
+		if (threads.size()) return;
+
 		int nCores = maxThreads > 0 ? maxThreads : GetNumSystemCores();
 		threads.resize(nCores);
 		for (int i = 0; i < nCores; ++i) {
@@ -134,6 +146,8 @@ namespace pol {
 	void Parallel::ParallelLoop(function<void(const RenderBlock & rb)> f, const vector<RenderBlock>& rbs) {
 		taskBarrier.lock();
 		nTasks = rbs.size();
+		nextTaskId = 0;
+		reportProgress = true;
 		for (int i = 0; i < nTasks; ++i) {
 			tasks.push(rbs[i]);
 		}
@@ -141,6 +155,37 @@ namespace pol {
 		taskBarrier.unlock();
 	}
 
+	void Parallel::ParallelFor(function<void(int)> f, int count, int chunkSize) {
+		if (count <= 0) return;
+
+		//nested loop would wait for tasks queued behind itself,
+		//so run it serially in the calling working thread
+		if (threadIndex >= 0 || backgroundThread || count <= chunkSize) {
+			for (int i = 0; i < count; ++i) f(i);
+			return;
+		}
+
+		Startup();
+
+		//reuse render block as a range of loop indices [sx, sx + w)
+		int nChunks = (count + chunkSize - 1) / chunkSize;
+		taskBarrier.lock();
+		nTasks = nChunks;
+		nextTaskId = 0;
+		reportProgress = false;
+		for (int i = 0; i < nChunks; ++i) {
+			int start = i * chunkSize;
+			RenderBlock rb = { start, 0, Min(chunkSize, count - start), 1 };
+			tasks.push(rb);
+		}
+		func = [&f](const RenderBlock& rb) {
+			for (int i = rb.sx; i < rb.sx + rb.w; ++i) f(i);
+		};
+		taskBarrier.unlock();
+
+		WaitUntilTaskFinish();
+	}
+
 	bool Parallel::IsFinish() {
 		return nextTaskId >= nTasks && activeThreads == 0;
 	}
@@ -156,4 +201,16 @@ namespace pol {
 	int Parallel::GetNumSystemCores() {
 		return thread::hardware_concurrency();
 	}
+
+	int Parallel::GetNumWorkingThreads() {
+		return maxThreads > 0 ? maxThreads : GetNumSystemCores();
+	}
+
+	int Parallel::GetThreadIndex() {
+		return threadIndex;
+	}
+
+	void Parallel::SetBackgroundThread() {
+		backgroundThread = true;
+	}
 }
\ No newline at end of file
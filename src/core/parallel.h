@@ -5,8 +5,46 @@
 #include <thread>
 #include <functional>
 #include <mutex>
+#include <atomic>
+#include <cstring>
 
 namespace pol {
+	//float which can be accumulated from multiple threads
+	class AtomicFloat {
+	private:
+		atomic<uint32_t> bits;
+
+	public:
+		AtomicFloat(Float v = 0) { bits = FloatToBits(v); }
+		AtomicFloat(const AtomicFloat& a) { bits = a.bits.load(); }
+
+		AtomicFloat& operator=(const AtomicFloat& a) { bits = a.bits.load(); return *this; }
+
+		operator Float() const { return BitsToFloat(bits); }
+
+		AtomicFloat& operator=(Float v) { bits = FloatToBits(v); return *this; }
+
+		void Add(Float v) {
+			uint32_t oldBits = bits, newBits;
+			do {
+				newBits = FloatToBits(BitsToFloat(oldBits) + v);
+			} while (!bits.compare_exchange_weak(oldBits, newBits));
+		}
+
+	private:
+		static __forceinline uint32_t FloatToBits(float f) {
+			uint32_t ui;
+			memcpy(&ui, &f, sizeof(float));
+			return ui;
+		}
+
+		static __forceinline float BitsToFloat(uint32_t ui) {
+			float f;
+			memcpy(&f, &ui, sizeof(uint32_t));
+			return f;
+		}
+	};
+
 	class Parallel {
 	private:
 		static vector<thread*> threads;
@@ -18,8 +56,16 @@ namespace pol {
 		static void ParallelLoop(function<void(const RenderBlock& rb)> func, const vector<RenderBlock>& rbs);
 		static bool IsFinish();
 		static void WaitUntilTaskFinish();
+		//blocking loop over [0, count), chunkSize indices per task
+		static void ParallelFor(function<void(int)> func, int count, int chunkSize = 1);
 
 		static void SetNumWorkingThreads(int n);
 		static int GetNumSystemCores();
+		static int GetNumWorkingThreads();
+		//index of current working thread, -1 for other threads
+		static int GetThreadIndex();
+		//thread pool runs one loop at a time, so loops issued from a thread
+		//running beside rendering, such as image writer, are run serially
+		static void SetBackgroundThread();
 	};
 }
\ No newline at end of file
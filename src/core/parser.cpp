@@ -2,6 +2,8 @@
 #include "propsets.h"
 #include "scene.h"
 #include "directory.h"
+#include "parallel.h"
+#include "texturecache.h"
 #include "../shape/triangle.h"
 
 #include <fstream>
@@ -69,6 +71,14 @@ namespace pol {
 			PolObjectFactory::CreateInstance(type, props, scene);
 		}
 
+		//parse texture cache, budget is in megabytes
+		if (doc.HasMember("textureCache")) {
+			PropSets props(&doc["textureCache"]);
+			TextureCache::SetBudget(int64_t(props.GetInt("budget", 1024)) << 20);
+			TextureCache::SetTileSize(props.GetInt("tileSize", 64));
+			TextureCache::Enable(props.GetBool("enable", true));
+		}
+
 		//parse texture
 		if (doc.HasMember("texture")) {
 			rapidjson::Value& textures = doc["texture"];
@@ -77,13 +87,13 @@ namespace pol {
 				exit(1);
 			}
 
-			rapidjson::Value::ValueIterator it = textures.Begin();
-			rapidjson::Value::ValueIterator ited = textures.End();
-			for (; it != ited; ++it) {
-				string type = (*it)["type"].GetString();
-				PropSets props(&(*it));
+			//textures do not depend on each other, so decode them in parallel
+			Parallel::ParallelFor([&](int i) {
+				rapidjson::Value& texture = textures[i];
+				string type = texture["type"].GetString();
+				PropSets props(&texture);
 				PolObjectFactory::CreateInstance(type, props, scene);
-			}
+				}, textures.Size());
 		}
 
 		//parse material
@@ -120,6 +130,15 @@ namespace pol {
 			}
 		}
 
+		//global settings, light strategy decides how emissive meshes are split
+		string lightSampleStrategy = "spatial";
+		bool lightPrecompute = false;
+		if (doc.HasMember("global")) {
+			PropSets props(&doc["global"]);
+			lightSampleStrategy = props.GetString("lightSampleStrategy", "spatial");
+			lightPrecompute = props.GetBool("lightPrecompute", false);
+		}
+
 		//parse light
 		if (doc.HasMember("light")) {
 			rapidjson::Value& lights = doc["light"];
@@ -144,18 +163,26 @@ namespace pol {
 						shape->SetLight(light);
 						light->SetShape(shape);
 					}
+					else if (lightSampleStrategy == "bvh") {
+						//light bvh chooses among triangles by distance and orientation,
+						//so every triangle is a light, which costs one light per triangle
+						TriangleMesh* mesh = dynamic_cast<TriangleMesh*>(object);
+						for (int i = 0; i < mesh->triangles.size(); ++i) {
+							Light* triangleLight = i == 0 ? light : dynamic_cast<Light*>(PolObjectFactory::CreateInstance(type, props, scene));
+							mesh->triangles[i]->SetLight(triangleLight);
+							triangleLight->SetShape(mesh->triangles[i]);
+						}
+
+						mesh->triangles.clear();
+					}
 					else {
+						//whole mesh is one light, triangles are chosen by area
+						//which keeps light count small, but ignores distance
+						//and orientation of triangles to shading point
 						TriangleMesh* mesh = dynamic_cast<TriangleMesh*>(object);
 						for (int i = 0; i < mesh->triangles.size(); ++i) {
-							if (i == 0) {
-								mesh->triangles[i]->SetLight(light);
-								light->SetShape(mesh->triangles[i]);
-							}
-							else {
-								Light* light = dynamic_cast<Light*>(PolObjectFactory::CreateInstance(type, props, scene));
-								mesh->triangles[i]->SetLight(light);
-								light->SetShape(mesh->triangles[i]);
-							}
+							mesh->triangles[i]->SetLight(light);
+							light->SetShape(mesh->triangles[i]);
 						}
 
 						mesh->triangles.clear();
@@ -164,13 +191,7 @@ namespace pol {
 			}
 		}
 
-		string lightSampleStrategy = "spatial";
-		if (doc.HasMember("global")) {
-			PropSets props(&doc["global"]);
-			lightSampleStrategy = props.GetString("lightSampleStrategy", "spatial");
-		}
-
-		scene.Prepare(lightSampleStrategy);
+		scene.Prepare(lightSampleStrategy, lightPrecompute);
 
 		return true;
 	}
@@ -5,8 +5,19 @@
 //http://www.pcg-random.org/
 
 #include "../pol.h"
+#include <immintrin.h>
 
 namespace pol {
+	//hash 64 bits integer to well distributed bits
+	__forceinline uint64_t MixBits(uint64_t v) {
+		v ^= (v >> 31);
+		v *= 0x7fb5d329728ea185ULL;
+		v ^= (v >> 27);
+		v *= 0x81dadef4bc2dd44dULL;
+		v ^= (v >> 33);
+		return v;
+	}
+
 	class Rng {
 	public:
 		mutable uint64_t state, inc;
@@ -44,4 +55,175 @@ namespace pol {
 				Float(UniformUInt() * 2.3283064365386963e-10f));
 		}
 	};
+
+	//several independent PCG32 streams advanced together with SIMD,
+	//8 lanes with AVX2 and 4 lanes with SSE2
+	//lane i of sequence s runs the same PCG32 as Rng(s * Lanes + i), so every lane
+	//keeps the statistical properties of scalar generator
+	//there is no 64 bits multiplication before AVX512, so it is built from
+	//32 bits partial products. state is kept in memory and loaded once per call,
+	//which avoids alignment issues of SIMD members
+	class RngSIMD {
+	public:
+#ifdef __AVX2__
+		static const int Lanes = 8;
+#else
+		static const int Lanes = 4;
+#endif
+
+	private:
+		mutable uint64_t state[Lanes], inc[Lanes];
+
+	public:
+		RngSIMD() {
+			Seed(0);
+		}
+
+		RngSIMD(uint64_t initseq) {
+			Seed(initseq);
+		}
+
+		__forceinline void Seed(uint64_t initseq) {
+			for (int i = 0; i < Lanes; ++i) {
+				Rng rng(initseq * Lanes + i);
+				state[i] = rng.state;
+				inc[i] = rng.inc;
+			}
+		}
+
+		//n values are written, the last partial block still advances all lanes
+		__forceinline void UniformUInt(uint32_t* out, int n) const {
+			Block s(state), c(inc);
+			for (int i = 0; i < n; i += Lanes) {
+				alignas(32) uint32_t v[Lanes];
+				Next(s, c, v);
+				int m = Min(Lanes, n - i);
+				for (int j = 0; j < m; ++j) out[i + j] = v[j];
+			}
+
+			s.Store(state);
+		}
+
+		//use the highest 24 bits, so values are exact in float and less than 1
+		__forceinline void UniformFloat(Float* out, int n) const {
+			Block s(state), c(inc);
+			for (int i = 0; i < n; i += Lanes) {
+				alignas(32) uint32_t v[Lanes];
+				alignas(32) float f[Lanes];
+				Next(s, c, v);
+				ToFloat(v, f);
+				int m = Min(Lanes, n - i);
+				for (int j = 0; j < m; ++j) out[i + j] = f[j];
+			}
+
+			s.Store(state);
+		}
+
+	private:
+#ifdef __AVX2__
+		struct Block {
+			__m256i lo, hi;
+
+			Block(const uint64_t* v) {
+				lo = _mm256_loadu_si256((const __m256i*)v);
+				hi = _mm256_loadu_si256((const __m256i*)(v + 4));
+			}
+
+			void Store(uint64_t* v) const {
+				_mm256_storeu_si256((__m256i*)v, lo);
+				_mm256_storeu_si256((__m256i*)(v + 4), hi);
+			}
+		};
+
+		static __forceinline __m256i Mul64(__m256i a, __m256i b) {
+			__m256i lo = _mm256_mul_epu32(a, b);
+			__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+				_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+			return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+		}
+
+		//advance 4 lanes, xorshifted value and rotation are in low 32 bits
+		static __forceinline void Step(__m256i& s, __m256i c, __m256i& xorshifted, __m256i& rot) {
+			const __m256i mul = _mm256_set1_epi64x(6364136223846793005ULL);
+			__m256i old = s;
+			s = _mm256_add_epi64(Mul64(old, mul), c);
+			xorshifted = _mm256_srli_epi64(_mm256_xor_si256(_mm256_srli_epi64(old, 18), old), 27);
+			rot = _mm256_srli_epi64(old, 59);
+		}
+
+		//gather low 32 bits of 64 bits lanes, in order of a then b
+		static __forceinline __m256i Pack(__m256i a, __m256i b) {
+			__m256i v = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+			return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		}
+
+		static __forceinline void Next(Block& s, const Block& c, uint32_t* out) {
+			__m256i x0, r0, x1, r1;
+			Step(s.lo, c.lo, x0, r0);
+			Step(s.hi, c.hi, x1, r1);
+			__m256i x = Pack(x0, x1);
+			__m256i r = Pack(r0, r1);
+			__m256i neg = _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), r), _mm256_set1_epi32(31));
+			__m256i v = _mm256_or_si256(_mm256_srlv_epi32(x, r), _mm256_sllv_epi32(x, neg));
+			_mm256_store_si256((__m256i*)out, v);
+		}
+
+		static __forceinline void ToFloat(const uint32_t* v, float* f) {
+			__m256i x = _mm256_srli_epi32(_mm256_load_si256((const __m256i*)v), 8);
+			_mm256_store_ps(f, _mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(5.9604644775390625e-8f)));
+		}
+#else
+		struct Block {
+			__m128i lo, hi;
+
+			Block(const uint64_t* v) {
+				lo = _mm_loadu_si128((const __m128i*)v);
+				hi = _mm_loadu_si128((const __m128i*)(v + 2));
+			}
+
+			void Store(uint64_t* v) const {
+				_mm_storeu_si128((__m128i*)v, lo);
+				_mm_storeu_si128((__m128i*)(v + 2), hi);
+			}
+		};
+
+		static __forceinline __m128i Mul64(__m128i a, __m128i b) {
+			__m128i lo = _mm_mul_epu32(a, b);
+			__m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b),
+				_mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+			return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+		}
+
+		//advance 2 lanes and output rotated value in low 32 bits
+		//SSE2 has no variable shift, rotation is done by multiplication:
+		//x * 2^(31-r) holds x>>(r+1) in high half and x<<(31-r) in low half,
+		//or of both halves is x rotated right by r+1, then rotate left by 1
+		static __forceinline __m128i Step(__m128i& s, __m128i c) {
+			const __m128i mul = _mm_set_epi64x(6364136223846793005LL, 6364136223846793005LL);
+			__m128i old = s;
+			s = _mm_add_epi64(Mul64(old, mul), c);
+			__m128i x = _mm_srli_epi64(_mm_xor_si128(_mm_srli_epi64(old, 18), old), 27);
+			__m128i r = _mm_srli_epi64(old, 59);
+			//2^k in float bits, converted to integer. 2^31 overflows and gives
+			//0x80000000 as integer indefinite value, which is still 2^31 as unsigned
+			__m128i k = _mm_sub_epi32(_mm_set1_epi32(31), r);
+			__m128i pow = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(k, _mm_set1_epi32(127)), 23)));
+			__m128i p = _mm_mul_epu32(_mm_and_si128(x, _mm_set_epi32(0, -1, 0, -1)), pow);
+			__m128i y = _mm_or_si128(p, _mm_srli_epi64(p, 32));
+			return _mm_or_si128(_mm_slli_epi32(y, 1), _mm_srli_epi32(y, 31));
+		}
+
+		static __forceinline void Next(Block& s, const Block& c, uint32_t* out) {
+			__m128i v0 = Step(s.lo, c.lo);
+			__m128i v1 = Step(s.hi, c.hi);
+			__m128i v = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(v0), _mm_castsi128_ps(v1), _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_store_si128((__m128i*)out, v);
+		}
+
+		static __forceinline void ToFloat(const uint32_t* v, float* f) {
+			__m128i x = _mm_srli_epi32(_mm_load_si128((const __m128i*)v), 8);
+			_mm_store_ps(f, _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(5.9604644775390625e-8f)));
+		}
+#endif
+	};
 }
\ No newline at end of file
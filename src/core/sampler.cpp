@@ -1,5 +1,6 @@
 #include "sampler.h"
 #include "scene.h"
+#include "parallel.h"
 
 namespace pol {
 	Sampler::Sampler(const PropSets& props, Scene& scene) {
@@ -11,10 +12,38 @@ namespace pol {
 
 	}
 
+	void Sampler::GetCameraSamples(CameraSample* samples, int count) const {
+		for (int i = 0; i < count; ++i) {
+			samples[i].film = Next2D();
+			samples[i].lens = Next2D();
+		}
+	}
+
+	void Sampler::Next1DArray(Float* u, int n) const {
+		for (int i = 0; i < n; ++i) u[i] = Next1D();
+	}
+
+	void Sampler::Next2DArray(Vector2f* u, int n) const {
+		for (int i = 0; i < n; ++i) u[i] = Next2D();
+	}
+
 	int Sampler::GetSampleCount() const {
 		return sampleCount;
 	}
 
+	ThreadSamplers::ThreadSamplers(const Sampler* sampler) {
+		samplers.resize(Parallel::GetNumWorkingThreads() + 1);
+		for (Sampler*& s : samplers) s = sampler->Clone();
+	}
+
+	ThreadSamplers::~ThreadSamplers() {
+		for (Sampler* s : samplers) delete s;
+	}
+
+	Sampler* ThreadSamplers::Get() const {
+		return samplers[Parallel::GetThreadIndex() + 1];
+	}
+
 	const int PrimeTableSize = 1000;
 	int primes[PrimeTableSize] = {
 	2, 3, 5, 7, 11,
@@ -101,19 +130,107 @@ namespace pol {
 	7829, 7841, 7853, 7867, 7873, 7877, 7879, 7883, 7901, 7907, 7919
 	};
 
-	Float RadicalInverse(unsigned int idx, unsigned int n) {
-		float ret = 0.f;
-		unsigned int base = primes[idx];
-		float invBase = 1.f / base;
-		float acc = invBase;
-		while (n) {
-			int m = n % base;
-			ret += m * acc;
+	static Float(*radicalInverseFuncs[SpecializedPrimeCount])(uint64_t) = {
+		RadicalInverseSpecialized<2>, RadicalInverseSpecialized<3>, RadicalInverseSpecialized<5>, RadicalInverseSpecialized<7>, RadicalInverseSpecialized<11>, RadicalInverseSpecialized<13>,
+		RadicalInverseSpecialized<17>, RadicalInverseSpecialized<19>, RadicalInverseSpecialized<23>, RadicalInverseSpecialized<29>, RadicalInverseSpecialized<31>, RadicalInverseSpecialized<37>,
+		RadicalInverseSpecialized<41>, RadicalInverseSpecialized<43>, RadicalInverseSpecialized<47>, RadicalInverseSpecialized<53>, RadicalInverseSpecialized<59>, RadicalInverseSpecialized<61>,
+		RadicalInverseSpecialized<67>, RadicalInverseSpecialized<71>, RadicalInverseSpecialized<73>, RadicalInverseSpecialized<79>, RadicalInverseSpecialized<83>, RadicalInverseSpecialized<89>,
+		RadicalInverseSpecialized<97>, RadicalInverseSpecialized<101>, RadicalInverseSpecialized<103>, RadicalInverseSpecialized<107>, RadicalInverseSpecialized<109>, RadicalInverseSpecialized<113>,
+		RadicalInverseSpecialized<127>, RadicalInverseSpecialized<131>, RadicalInverseSpecialized<137>, RadicalInverseSpecialized<139>, RadicalInverseSpecialized<149>, RadicalInverseSpecialized<151>,
+		RadicalInverseSpecialized<157>, RadicalInverseSpecialized<163>, RadicalInverseSpecialized<167>, RadicalInverseSpecialized<173>, RadicalInverseSpecialized<179>, RadicalInverseSpecialized<181>,
+		RadicalInverseSpecialized<191>, RadicalInverseSpecialized<193>, RadicalInverseSpecialized<197>, RadicalInverseSpecialized<199>, RadicalInverseSpecialized<211>, RadicalInverseSpecialized<223>,
+		RadicalInverseSpecialized<227>, RadicalInverseSpecialized<229>, RadicalInverseSpecialized<233>, RadicalInverseSpecialized<239>, RadicalInverseSpecialized<241>, RadicalInverseSpecialized<251>,
+		RadicalInverseSpecialized<257>, RadicalInverseSpecialized<263>, RadicalInverseSpecialized<269>, RadicalInverseSpecialized<271>, RadicalInverseSpecialized<277>, RadicalInverseSpecialized<281>,
+		RadicalInverseSpecialized<283>, RadicalInverseSpecialized<293>, RadicalInverseSpecialized<307>, RadicalInverseSpecialized<311>, RadicalInverseSpecialized<313>, RadicalInverseSpecialized<317>,
+		RadicalInverseSpecialized<331>, RadicalInverseSpecialized<337>, RadicalInverseSpecialized<347>, RadicalInverseSpecialized<349>, RadicalInverseSpecialized<353>, RadicalInverseSpecialized<359>,
+		RadicalInverseSpecialized<367>, RadicalInverseSpecialized<373>, RadicalInverseSpecialized<379>, RadicalInverseSpecialized<383>, RadicalInverseSpecialized<389>, RadicalInverseSpecialized<397>,
+		RadicalInverseSpecialized<401>, RadicalInverseSpecialized<409>, RadicalInverseSpecialized<419>, RadicalInverseSpecialized<421>, RadicalInverseSpecialized<431>, RadicalInverseSpecialized<433>,
+		RadicalInverseSpecialized<439>, RadicalInverseSpecialized<443>, RadicalInverseSpecialized<449>, RadicalInverseSpecialized<457>, RadicalInverseSpecialized<461>, RadicalInverseSpecialized<463>,
+		RadicalInverseSpecialized<467>, RadicalInverseSpecialized<479>, RadicalInverseSpecialized<487>, RadicalInverseSpecialized<491>, RadicalInverseSpecialized<499>, RadicalInverseSpecialized<503>,
+		RadicalInverseSpecialized<509>, RadicalInverseSpecialized<521>, RadicalInverseSpecialized<523>, RadicalInverseSpecialized<541>, RadicalInverseSpecialized<547>, RadicalInverseSpecialized<557>,
+		RadicalInverseSpecialized<563>, RadicalInverseSpecialized<569>, RadicalInverseSpecialized<571>, RadicalInverseSpecialized<577>, RadicalInverseSpecialized<587>, RadicalInverseSpecialized<593>,
+		RadicalInverseSpecialized<599>, RadicalInverseSpecialized<601>, RadicalInverseSpecialized<607>, RadicalInverseSpecialized<613>, RadicalInverseSpecialized<617>, RadicalInverseSpecialized<619>,
+		RadicalInverseSpecialized<631>, RadicalInverseSpecialized<641>, RadicalInverseSpecialized<643>, RadicalInverseSpecialized<647>, RadicalInverseSpecialized<653>, RadicalInverseSpecialized<659>,
+		RadicalInverseSpecialized<661>, RadicalInverseSpecialized<673>, RadicalInverseSpecialized<677>, RadicalInverseSpecialized<683>, RadicalInverseSpecialized<691>, RadicalInverseSpecialized<701>,
+		RadicalInverseSpecialized<709>, RadicalInverseSpecialized<719>
+	};
+
+	static Float(*scrambledRadicalInverseFuncs[SpecializedPrimeCount])(const uint16_t*, uint64_t) = {
+		ScrambledRadicalInverseSpecialized<2>, ScrambledRadicalInverseSpecialized<3>, ScrambledRadicalInverseSpecialized<5>, ScrambledRadicalInverseSpecialized<7>, ScrambledRadicalInverseSpecialized<11>, ScrambledRadicalInverseSpecialized<13>,
+		ScrambledRadicalInverseSpecialized<17>, ScrambledRadicalInverseSpecialized<19>, ScrambledRadicalInverseSpecialized<23>, ScrambledRadicalInverseSpecialized<29>, ScrambledRadicalInverseSpecialized<31>, ScrambledRadicalInverseSpecialized<37>,
+		ScrambledRadicalInverseSpecialized<41>, ScrambledRadicalInverseSpecialized<43>, ScrambledRadicalInverseSpecialized<47>, ScrambledRadicalInverseSpecialized<53>, ScrambledRadicalInverseSpecialized<59>, ScrambledRadicalInverseSpecialized<61>,
+		ScrambledRadicalInverseSpecialized<67>, ScrambledRadicalInverseSpecialized<71>, ScrambledRadicalInverseSpecialized<73>, ScrambledRadicalInverseSpecialized<79>, ScrambledRadicalInverseSpecialized<83>, ScrambledRadicalInverseSpecialized<89>,
+		ScrambledRadicalInverseSpecialized<97>, ScrambledRadicalInverseSpecialized<101>, ScrambledRadicalInverseSpecialized<103>, ScrambledRadicalInverseSpecialized<107>, ScrambledRadicalInverseSpecialized<109>, ScrambledRadicalInverseSpecialized<113>,
+		ScrambledRadicalInverseSpecialized<127>, ScrambledRadicalInverseSpecialized<131>, ScrambledRadicalInverseSpecialized<137>, ScrambledRadicalInverseSpecialized<139>, ScrambledRadicalInverseSpecialized<149>, ScrambledRadicalInverseSpecialized<151>,
+		ScrambledRadicalInverseSpecialized<157>, ScrambledRadicalInverseSpecialized<163>, ScrambledRadicalInverseSpecialized<167>, ScrambledRadicalInverseSpecialized<173>, ScrambledRadicalInverseSpecialized<179>, ScrambledRadicalInverseSpecialized<181>,
+		ScrambledRadicalInverseSpecialized<191>, ScrambledRadicalInverseSpecialized<193>, ScrambledRadicalInverseSpecialized<197>, ScrambledRadicalInverseSpecialized<199>, ScrambledRadicalInverseSpecialized<211>, ScrambledRadicalInverseSpecialized<223>,
+		ScrambledRadicalInverseSpecialized<227>, ScrambledRadicalInverseSpecialized<229>, ScrambledRadicalInverseSpecialized<233>, ScrambledRadicalInverseSpecialized<239>, ScrambledRadicalInverseSpecialized<241>, ScrambledRadicalInverseSpecialized<251>,
+		ScrambledRadicalInverseSpecialized<257>, ScrambledRadicalInverseSpecialized<263>, ScrambledRadicalInverseSpecialized<269>, ScrambledRadicalInverseSpecialized<271>, ScrambledRadicalInverseSpecialized<277>, ScrambledRadicalInverseSpecialized<281>,
+		ScrambledRadicalInverseSpecialized<283>, ScrambledRadicalInverseSpecialized<293>, ScrambledRadicalInverseSpecialized<307>, ScrambledRadicalInverseSpecialized<311>, ScrambledRadicalInverseSpecialized<313>, ScrambledRadicalInverseSpecialized<317>,
+		ScrambledRadicalInverseSpecialized<331>, ScrambledRadicalInverseSpecialized<337>, ScrambledRadicalInverseSpecialized<347>, ScrambledRadicalInverseSpecialized<349>, ScrambledRadicalInverseSpecialized<353>, ScrambledRadicalInverseSpecialized<359>,
+		ScrambledRadicalInverseSpecialized<367>, ScrambledRadicalInverseSpecialized<373>, ScrambledRadicalInverseSpecialized<379>, ScrambledRadicalInverseSpecialized<383>, ScrambledRadicalInverseSpecialized<389>, ScrambledRadicalInverseSpecialized<397>,
+		ScrambledRadicalInverseSpecialized<401>, ScrambledRadicalInverseSpecialized<409>, ScrambledRadicalInverseSpecialized<419>, ScrambledRadicalInverseSpecialized<421>, ScrambledRadicalInverseSpecialized<431>, ScrambledRadicalInverseSpecialized<433>,
+		ScrambledRadicalInverseSpecialized<439>, ScrambledRadicalInverseSpecialized<443>, ScrambledRadicalInverseSpecialized<449>, ScrambledRadicalInverseSpecialized<457>, ScrambledRadicalInverseSpecialized<461>, ScrambledRadicalInverseSpecialized<463>,
+		ScrambledRadicalInverseSpecialized<467>, ScrambledRadicalInverseSpecialized<479>, ScrambledRadicalInverseSpecialized<487>, ScrambledRadicalInverseSpecialized<491>, ScrambledRadicalInverseSpecialized<499>, ScrambledRadicalInverseSpecialized<503>,
+		ScrambledRadicalInverseSpecialized<509>, ScrambledRadicalInverseSpecialized<521>, ScrambledRadicalInverseSpecialized<523>, ScrambledRadicalInverseSpecialized<541>, ScrambledRadicalInverseSpecialized<547>, ScrambledRadicalInverseSpecialized<557>,
+		ScrambledRadicalInverseSpecialized<563>, ScrambledRadicalInverseSpecialized<569>, ScrambledRadicalInverseSpecialized<571>, ScrambledRadicalInverseSpecialized<577>, ScrambledRadicalInverseSpecialized<587>, ScrambledRadicalInverseSpecialized<593>,
+		ScrambledRadicalInverseSpecialized<599>, ScrambledRadicalInverseSpecialized<601>, ScrambledRadicalInverseSpecialized<607>, ScrambledRadicalInverseSpecialized<613>, ScrambledRadicalInverseSpecialized<617>, ScrambledRadicalInverseSpecialized<619>,
+		ScrambledRadicalInverseSpecialized<631>, ScrambledRadicalInverseSpecialized<641>, ScrambledRadicalInverseSpecialized<643>, ScrambledRadicalInverseSpecialized<647>, ScrambledRadicalInverseSpecialized<653>, ScrambledRadicalInverseSpecialized<659>,
+		ScrambledRadicalInverseSpecialized<661>, ScrambledRadicalInverseSpecialized<673>, ScrambledRadicalInverseSpecialized<677>, ScrambledRadicalInverseSpecialized<683>, ScrambledRadicalInverseSpecialized<691>, ScrambledRadicalInverseSpecialized<701>,
+		ScrambledRadicalInverseSpecialized<709>, ScrambledRadicalInverseSpecialized<719>
+	};
 
-			n /= base;
-			acc *= invBase;
+	Float RadicalInverse(unsigned int idx, uint64_t n) {
+		if (idx < SpecializedPrimeCount) return radicalInverseFuncs[idx](n);
+
+		//generic version for higher dimensions
+		uint64_t base = primes[idx % PrimeTableSize];
+		double invBase = 1.0 / base;
+		uint64_t reversedDigits = 0;
+		double invBaseN = 1;
+		while (n) {
+			uint64_t next = n / base;
+			reversedDigits = reversedDigits * base + (n - next * base);
+			invBaseN *= invBase;
+			n = next;
 		}
 
-		return ret;
+		return Min(Float(reversedDigits * invBaseN), Float(0.99999994));
+	}
+
+	Float ScrambledRadicalInverse(unsigned int idx, uint64_t n, const uint16_t* perm) {
+		return scrambledRadicalInverseFuncs[idx](perm, n);
+	}
+
+	const uint16_t* GetRadicalInversePermutation(unsigned int idx) {
+		struct PermutationTable {
+			vector<uint16_t> perms;
+			int offsets[SpecializedPrimeCount];
+
+			PermutationTable() {
+				Rng rng;
+				int size = 0;
+				for (int i = 0; i < SpecializedPrimeCount; ++i) {
+					offsets[i] = size;
+					size += primes[i];
+				}
+
+				perms.resize(size);
+				for (int i = 0; i < SpecializedPrimeCount; ++i) {
+					uint16_t* p = &perms[offsets[i]];
+					int base = primes[i];
+					for (int j = 0; j < base; ++j) p[j] = j;
+					//fisher-yates shuffle
+					for (int j = base - 1; j > 0; --j) {
+						int k = rng.UniformUInt() % (j + 1);
+						swap(p[j], p[k]);
+					}
+				}
+			}
+		};
+
+		//initialization of local static is thread safe
+		static PermutationTable table;
+		return &table.perms[table.offsets[idx]];
 	}
 }
\ No newline at end of file
@@ -4,6 +4,12 @@
 #include "rng.h"
 
 namespace pol {
+	//samples used by camera to generate primary ray
+	struct CameraSample {
+		Vector2f film;
+		Vector2f lens;
+	};
+
 	class Sampler : public PolObject {
 	protected:
 		int sampleCount;
@@ -13,12 +19,81 @@ namespace pol {
 		virtual ~Sampler();
 
 		virtual void Prepare(uint64_t idx) = 0;
+		//fill camera samples of the first count samples of current pixel at once,
+		//must be called right after Prepare
+		virtual void GetCameraSamples(CameraSample* samples, int count) const;
+		//start a new sample of current pixel, dimensions used by camera
+		//samples are skipped. samplers without sample structure just continue the stream
+		virtual void SetSampleIndex(int idx) {}
 		virtual Float Next1D() const = 0;
 		virtual Vector2f Next2D() const = 0;
+		//fill n consecutive dimensions of current sample at once
+		virtual void Next1DArray(Float* u, int n) const;
+		virtual void Next2DArray(Vector2f* u, int n) const;
 		virtual Sampler* Clone() const = 0;
 
 		int GetSampleCount() const;
 	};
 
-	Float RadicalInverse(unsigned int idx, unsigned int n);
+	//one sampler for each working thread and the calling thread,
+	//so samplers are reused across render blocks instead of being cloned
+	class ThreadSamplers {
+	private:
+		vector<Sampler*> samplers;
+
+	public:
+		ThreadSamplers(const Sampler* sampler);
+		~ThreadSamplers();
+
+		//sampler of current thread
+		Sampler* Get() const;
+	};
+
+	//number of leading prime bases that have specialized radical inverse
+	//and digit permutation tables
+	const int SpecializedPrimeCount = 128;
+
+	//reverse digits of a in given base and put them after radix point,
+	//base is known at compile time so divisions are turned into multiplications
+	template<uint64_t base>
+	Float RadicalInverseSpecialized(uint64_t a) {
+		const double invBase = 1.0 / base;
+		uint64_t reversedDigits = 0;
+		double invBaseN = 1;
+		while (a) {
+			uint64_t next = a / base;
+			uint64_t digit = a - next * base;
+			reversedDigits = reversedDigits * base + digit;
+			invBaseN *= invBase;
+			a = next;
+		}
+
+		return Min(Float(reversedDigits * invBaseN), Float(0.99999994));
+	}
+
+	//digits are permuted before reversed, the infinite trailing zero digits
+	//are permuted to perm[0] too, which sums to perm[0]*invBase/(1-invBase)
+	template<uint64_t base>
+	Float ScrambledRadicalInverseSpecialized(const uint16_t* perm, uint64_t a) {
+		const double invBase = 1.0 / base;
+		uint64_t reversedDigits = 0;
+		double invBaseN = 1;
+		while (a) {
+			uint64_t next = a / base;
+			uint64_t digit = a - next * base;
+			reversedDigits = reversedDigits * base + perm[digit];
+			invBaseN *= invBase;
+			a = next;
+		}
+
+		return Min(Float(invBaseN * (reversedDigits + invBase * perm[0] / (1 - invBase))), Float(0.99999994));
+	}
+
+	//idx is index of prime base
+	Float RadicalInverse(unsigned int idx, uint64_t n);
+	//idx must be less than SpecializedPrimeCount
+	Float ScrambledRadicalInverse(unsigned int idx, uint64_t n, const uint16_t* perm);
+	//random digit permutations of each specialized prime base,
+	//computed once with a fixed seed and shared by all samplers
+	const uint16_t* GetRadicalInversePermutation(unsigned int idx);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "scene.h"
 #include "renderblock.h"
 #include "parallel.h"
+#include <algorithm>
 
 namespace pol {
 	Scene::Scene() {
@@ -9,6 +10,7 @@ namespace pol {
 		integrator = nullptr;
 		accelerator = nullptr;
 		infinite = nullptr;
+		lightDistribution = nullptr;
 	}
 
 	Scene::~Scene() {
@@ -16,9 +18,15 @@ namespace pol {
 		POL_SAFE_DELETE(sampler);
 		POL_SAFE_DELETE(integrator);
 		POL_SAFE_DELETE(accelerator);
+		POL_SAFE_DELETE(lightDistribution);
 
 		for (TextureIterator it = textures.begin(); it != textures.end(); ++it) POL_SAFE_DELETE(it->second);
+		for (auto& it : mipmaps) {
+			POL_SAFE_DELETE(it.second->mipmap);
+			POL_SAFE_DELETE(it.second);
+		}
 		for (BsdfIterator it = bsdfs.begin(); it != bsdfs.end(); ++it) POL_SAFE_DELETE(it->second);
+		for (BssrdfIterator it = bssrdfs.begin(); it != bssrdfs.end(); ++it) POL_SAFE_DELETE(it->second);
 		for (Shape* shape : primitives) POL_SAFE_DELETE(shape);
 		for (Light* light : lights) POL_SAFE_DELETE(light);
 
@@ -54,6 +62,7 @@ namespace pol {
 	}
 
 	void Scene::AddLight(Light* l) {
+		l->SetIndex(lights.size());
 		lights.push_back(l);
 	}
 
@@ -66,7 +75,17 @@ namespace pol {
 		bsdfs[name] = b;
 	}
 
+	void Scene::AddBssrdf(const string& name, Bssrdf* b) {
+		if (bssrdfs.find(name) != bssrdfs.end()) {
+			fprintf(stderr, "bssrdf named [\"%s\"] already exists\n", name.c_str());
+			return;
+		}
+
+		bssrdfs[name] = b;
+	}
+
 	void Scene::AddTexture(const string& name, Texture* t) {
+		lock_guard<mutex> lock(textureMutex);
 		if (textures.find(name) != textures.end()) {
 			fprintf(stderr, "texture named [\"%s\"] already exists\n", name.c_str());
 			return;
@@ -75,7 +94,26 @@ namespace pol {
 		textures[name] = t;
 	}
 
-	void Scene::Prepare(const string& lightStrategy) {
+	const Mipmap* Scene::GetMipmap(const string& key, const function<void(Mipmap&)>& build) {
+		MipmapEntry* entry;
+		{
+			lock_guard<mutex> lock(mipmapMutex);
+			MipmapEntry*& e = mipmaps[key];
+			if (!e) e = new MipmapEntry();
+			entry = e;
+		}
+
+		//map lock is released while building, so different files load in parallel
+		call_once(entry->once, [&]() {
+			Mipmap* mipmap = new Mipmap();
+			build(*mipmap);
+			entry->mipmap = mipmap;
+			});
+
+		return entry->mipmap;
+	}
+
+	void Scene::Prepare(const string& lightStrategy, bool lightPrecompute) {
 		bool terminal = false;
 		if (!integrator) {
 			printf("There is no integrator in the scene\n");
@@ -115,6 +153,11 @@ namespace pol {
 			}
 		}
 
+		//bounds is not provided by accelerator
+		if (!accelerator) {
+			for (const Shape* shape : primitives) worldBBox.Union(shape->WorldBBox());
+		}
+
 		//light prepare
 		for (Light* light : lights) {
 			light->Prepare(*this);
@@ -129,12 +172,14 @@ namespace pol {
 			//bidirectional methods using power distribution by default
 			lightDistribution = new PowerLightDistribution(*this);
 		}
-		else if (lightStrategy == "spatial") {
-			lightDistribution = new SpatialLightDistribution(*this);
+		else if (lightStrategy == "bvh") {
+			lightDistribution = new LightBvhDistribution(*this);
 		}
 		else {
-			//unknown strategy, use spatial method
-			lightDistribution = new SpatialLightDistribution(*this);
+			//spatial method, also for unknown strategy
+			SpatialLightDistribution* spatial = new SpatialLightDistribution(*this);
+			if (lightPrecompute) spatial->Precompute();
+			lightDistribution = spatial;
 		}
 
 		//init parallel
@@ -153,6 +198,31 @@ namespace pol {
 			}
 		}
 
+		computeFrame(isect);
+
+		return intersect;
+	}
+
+	bool Scene::IntersectObject(const Bssrdf* object, Ray& ray, Intersection& isect) const {
+		bool intersect = false;
+		if (accelerator) {
+			intersect = accelerator->IntersectObject(object, ray, isect);
+		}
+		else {
+			//brute force
+			for (const Shape* shape : primitives) {
+				if (shape->GetBssrdf() != object) continue;
+
+				intersect |= shape->Intersect(ray, isect);
+			}
+		}
+
+		computeFrame(isect);
+
+		return intersect;
+	}
+
+	void Scene::computeFrame(Intersection& isect) const {
 		if (isect.dpdu == Vector3f::Zero() || isect.dpdv == Vector3f::Zero()) {
 			isect.geoFrame = Frame(isect.n);
 			isect.shFrame = isect.geoFrame;
@@ -164,8 +234,6 @@ namespace pol {
 			isect.geoFrame = Frame(dpdu, isect.n, dpdv);
 			isect.shFrame = isect.geoFrame;
 		}
-
-		return intersect;
 	}
 
 	bool Scene::Occluded(const Ray& ray) const {
@@ -188,41 +256,76 @@ namespace pol {
 		Sampler* sampler = this->sampler;
 		int sampleCount = sampler->GetSampleCount();
 
-		if (!integrator->IsBidirectional()) {
+		if (film->HasAov() && !integrator->HasAov()) {
+			fprintf(stderr, "aov and denoise are not supported by this integrator\n");
+			film->DisableAov();
+		}
+
+		bool stream = film->stream;
+		if (!integrator->IsBidirectional() && !integrator->IsProgressive()) {
+			//samplers are released at the end of scope, so wait for tasks inside
+			ThreadSamplers samplers(sampler);
 			vector<RenderBlock> rbs;
 			//get render block
 			InitRenderBlock(*this, rbs);
+			if (stream) {
+				//rows of blocks are finished in order, so only a few of them are kept
+				sort(rbs.begin(), rbs.end(), [](const RenderBlock& a, const RenderBlock& b) {
+					return a.sy < b.sy || (a.sy == b.sy && a.sx < b.sx);
+					});
+				if (!film->BeginStream(Float(1) / sampleCount)) return;
+			}
 
 			Parallel::ParallelLoop([&](const RenderBlock& rb) {
-				Sampler* samplerClone = sampler->Clone();
+				Sampler* samplerClone = samplers.Get();
+				vector<CameraSample> cameraSamples(sampleCount);
+				vector<Vector3f> colors(rb.w * rb.h);
 				int sx = rb.sx, sy = rb.sy;
 				int ex = rb.sx + rb.w, ey = rb.sy + rb.h;
 				for (int i = sx; i < ex; ++i) {
 					for (int j = sy; j < ey; ++j) {
 						samplerClone->Prepare(j * film->res.x + i);
+						samplerClone->GetCameraSamples(&cameraSamples[0], sampleCount);
 						Vector3f color(0.f);
 						for (int s = 0; s < sampleCount; ++s) {
-							Vector2f offset = samplerClone->Next2D() - Vector2f(0.5);
+							samplerClone->SetSampleIndex(s);
+							Vector2f offset = cameraSamples[s].film - Vector2f(0.5);
 							Vector2f sample = Vector2f(i, j) + offset;
-							RayDifferential ray = camera->GenerateRayDifferential(sample, samplerClone->Next2D());
-
-							color += integrator->Li(ray, *this, samplerClone);
+							RayDifferential ray = camera->GenerateRayDifferential(sample, cameraSamples[s].lens);
+
+							if (film->HasAov()) {
+								AovSample aov;
+								color += integrator->Li(ray, *this, samplerClone, &aov);
+								film->AddAov(Vector2i(i, j), aov.albedo, aov.normal, aov.depth);
+							}
+							else {
+								color += integrator->Li(ray, *this, samplerClone);
+							}
 						}
 
-						film->AddPixel(Vector2f(i, j), color);
+						colors[(j - sy) * rb.w + i - sx] = color;
 					}
 				}
 
-				delete samplerClone;
+				film->AddBlock(rb, &colors[0]);
 				}, rbs);
+			while (!Parallel::IsFinish());
 		}
 		else {
+			//these integrators write anywhere on film
+			if (stream) {
+				fprintf(stderr, "stream mode is not supported by this integrator\n");
+				film->DisableStream();
+				stream = false;
+			}
+
 			integrator->Render(*this);
 		}
 		
 		while (!Parallel::IsFinish());
 
-		film->WriteImage(Float(1) / sampleCount);
+		if (stream) film->EndStream();
+		else film->WriteImage(Float(1) / sampleCount);
 	}
 
 	//return a brief string summary of the instance(for debugging purposes)
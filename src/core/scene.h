@@ -8,7 +8,9 @@
 #include "integrator.h"
 #include "light.h"
 #include "bsdf.h"
+#include "bssrdf.h"
 #include "texture.h"
+#include "mipmap.h"
 #include "distribution.h"
 #include "lightdistrib.h"
 
@@ -25,10 +27,25 @@ namespace pol {
 		Light* infinite;
 		typedef map<string, Bsdf*>::iterator BsdfIterator;
 		typedef map<string, Bsdf*>::const_iterator ConstBsdfIterator;
+		typedef map<string, Bssrdf*>::iterator BssrdfIterator;
+		typedef map<string, Bssrdf*>::const_iterator ConstBssrdfIterator;
 		typedef map<string, Texture*>::iterator TextureIterator;
 		typedef map<string, Texture*>::const_iterator ConstTextureIterator;
 		map<string, Bsdf*> bsdfs;
+		map<string, Bssrdf*> bssrdfs;
 		map<string, Texture*> textures;
+		//textures are created in parallel
+		mutex textureMutex;
+		//mipmaps shared by textures and lights loaded from same file,
+		//keyed by path and build parameters, each is built only once
+		struct MipmapEntry {
+			once_flag once;
+			Mipmap* mipmap;
+
+			MipmapEntry() :mipmap(nullptr) {}
+		};
+		map<string, MipmapEntry*> mipmaps;
+		mutex mipmapMutex;
 
 		LightDistribution* lightDistribution;
 		BBox worldBBox;
@@ -45,7 +62,11 @@ namespace pol {
 		void AddPrimitive(Shape* s);
 		void AddLight(Light* l);
 		void AddBsdf(const string& name, Bsdf* b);
+		void AddBssrdf(const string& name, Bssrdf* b);
 		void AddTexture(const string& name, Texture* t);
+		//return shared mipmap of key, build is called by first caller only,
+		//others wait until it is built, returned mipmap must not be modified
+		const Mipmap* GetMipmap(const string& key, const function<void(Mipmap&)>& build);
 
 		__forceinline Camera* GetCamera() const { return camera; }
 		__forceinline Sampler* GetSampler() const { return sampler; }
@@ -54,26 +75,43 @@ namespace pol {
 		__forceinline Light* GetLight(int idx) const { POL_ASSERT(idx < lights.size());  return lights[idx]; }
 		__forceinline vector<Light*> GetLight() const { return lights; }
 		__forceinline Light* GetInfiniteLight() const { return infinite; }
-		__forceinline int GetLightIndex(const Light* l) const { for (int i = 0; i < lights.size(); ++i) if (lights[i] == l) return i; return -1; }
+		__forceinline int GetLightIndex(const Light* l) const { return l ? l->GetIndex() : -1; }
 		__forceinline Shape* GetShape(int idx) const { POL_ASSERT(idx < primitives.size()); return primitives[idx]; }
+		__forceinline int GetShapeCount() const { return primitives.size(); }
 		__forceinline Bsdf* GetBsdf(string& name) const { ConstBsdfIterator it = bsdfs.find(name);  if (it == bsdfs.end()) return nullptr;  return it->second; }
+		__forceinline Bssrdf* GetBssrdf(string& name) const { ConstBssrdfIterator it = bssrdfs.find(name);  if (it == bssrdfs.end()) return nullptr;  return it->second; }
 		__forceinline Texture* GetTexture(string& name) const { ConstTextureIterator it = textures.find(name); if (it == textures.end()) return nullptr; return it->second; }
 		__forceinline BBox GetBBox() const { return worldBBox; }
 
 		//prepare before rendering
-		void Prepare(const string& lightStrategy);
+		//lightPrecompute : compute spatial light distribution before rendering
+		void Prepare(const string& lightStrategy, bool lightPrecompute = false);
 
 		//light lookup
-		//choose a light from uniform number u
+		//distribution of shading point p, look it up once per shading point
+		//and pass it to LightSample and LightPdf of that point
 		__forceinline const Distribution1D* LightLookup(const Vector3f& p) const {
 			return lightDistribution->Lookup(p);
 		}
+		//choose a light for shading point p with normal n
+		//return -1 if no light can contribute
+		__forceinline int LightSample(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, Float u, Float& pdf) const {
+			return lightDistribution->Sample(distribution, p, n, u, pdf);
+		}
+		__forceinline Float LightPdf(const Distribution1D* distribution, const Vector3f& p, const Vector3f& n, int lightIdx) const {
+			return lightDistribution->Pdf(distribution, p, n, lightIdx);
+		}
 
 		bool Intersect(Ray& ray, Intersection& isect) const;
+		//intersect only primitives sharing the bssrdf, used by subsurface probe rays
+		bool IntersectObject(const Bssrdf* object, Ray& ray, Intersection& isect) const;
 		bool Occluded(const Ray& ray) const;
 		void Render() const;
 
 		//return a brief string summary of the instance(for debugging purposes)
 		string ToString() const;
+
+	private:
+		void computeFrame(Intersection& isect) const;
 	};
 }
\ No newline at end of file
@@ -5,6 +5,8 @@ namespace pol {
 	Shape::Shape(const PropSets& props, Scene& scene) {
 		string bsdfName = props.GetString("bsdf");
 		bsdf = scene.GetBsdf(bsdfName);
+		string bssrdfName = props.GetString("bssrdf", "");
+		bssrdf = scene.GetBssrdf(bssrdfName);
 
 		light = nullptr;
 
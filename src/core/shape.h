@@ -34,8 +34,15 @@ namespace pol {
 		//soldAngle : pdf in which type (area or solidAngle)
 		virtual Float Pdf(const Vector3f& pOnLight, const Vector3f& pOnSurface, bool& solidAngle) const = 0;
 
+		//bounds of normals on surface, full sphere by default
+		virtual void NormalBounds(Vector3f& axis, Float& cosTheta) const {
+			axis = Vector3f::Up();
+			cosTheta = -1;
+		}
+
 		virtual void SetLight(Light* l) { light = l; }
 		const Bsdf* GetBsdf() const { return bsdf;  }
+		const Bssrdf* GetBssrdf() const { return bssrdf; }
 	};
 
 	//helper function
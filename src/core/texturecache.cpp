@@ -0,0 +1,370 @@
+#include "texturecache.h"
+#include "memory.h"
+#include "imageio.h"
+#include "directory.h"
+#include <map>
+#include <memory>
+#include <cstring>
+
+namespace pol {
+	//cache file starts with magic, size and modified time of source, srgb, flip,
+	//format, log2 of tile size, width and height of level 0, then tiles of all
+	//levels follow level by level in row order, padded tiles have same size
+	static const char cacheMagic[4] = { 'P', 'T', 'X', '2' };
+
+	static int64_t TileCount(int w, int h, int logTileSize) {
+		int64_t nTiles = 0;
+		int tileSize = 1 << logTileSize;
+		int nLevel = Mipmap::LevelCount(w, h);
+		for (int i = 0; i < nLevel; ++i) {
+			//same rounding down rule as setupLevels
+			nTiles += int64_t((w + tileSize - 1) >> logTileSize) * ((h + tileSize - 1) >> logTileSize);
+			w = w == 1 ? 1 : w >> 1;
+			h = h == 1 ? 1 : h >> 1;
+		}
+
+		return nTiles;
+	}
+
+	//one slot for each thread which ever looked up a tiled texture,
+	//slot holds epoch when thread was pinned or 0 when it is not
+	static const int maxEpochSlots = 256;
+	struct alignas(POL_L1_CACHE_LINE_SIZE) EpochSlot {
+		atomic<uint64_t> epoch;
+	};
+	static EpochSlot epochSlots[maxEpochSlots];
+	static atomic<int> nEpochSlots(0);
+	thread_local int epochSlot = -1;
+	thread_local int pinDepth = 0;
+
+	mutex TextureCache::cacheMutex;
+	int64_t TextureCache::budget = int64_t(1) << 30;
+	int64_t TextureCache::residentBytes = 0;
+	int TextureCache::logTileSize = 6;
+	bool TextureCache::enabled = false;
+	vector<TextureTile*> TextureCache::resident;
+	int TextureCache::clockHand = 0;
+	vector<pair<TextureTile*, uint64_t>> TextureCache::retired;
+	atomic<uint64_t> TextureCache::epoch(1);
+
+	TiledImage::TiledImage() {
+		format = TexelFormat::E_RGB8;
+		decodeTable = nullptr;
+		logTileSize = 0;
+		tileBytes = 0;
+		dataOffset = 0;
+	}
+
+	TiledImage::~TiledImage() {
+		TextureCache::Release(this);
+	}
+
+	bool TiledImage::Open(const string& source, bool srgb, bool flip, TexelFormat format) {
+		this->format = format;
+		decodeTable = ImageIO::GetDecodeTable(srgb);
+		logTileSize = TextureCache::GetLogTileSize();
+		tileBytes = Mipmap::TexelSize(format) << (2 * logTileSize);
+
+		//source is only read when cache is missing or out of date
+		int64_t size, time;
+		if (!Directory::GetFileStamp(source, size, time)) {
+			fprintf(stderr, "Can not read texture [%s]\n", source.c_str());
+			return false;
+		}
+
+		//textures are created in parallel, several of them may share one source
+		static mutex createMutex;
+		static map<string, shared_ptr<mutex>> fileMutexes;
+		shared_ptr<mutex> m;
+		{
+			lock_guard<mutex> lock(createMutex);
+			shared_ptr<mutex>& p = fileMutexes[source];
+			if (!p) p = make_shared<mutex>();
+			m = p;
+		}
+
+		lock_guard<mutex> lock(*m);
+		string cacheFile = source + ".tiled";
+		if (readHeader(cacheFile, size, time, srgb, flip)) return true;
+		if (!createCache(source, cacheFile, size, time, srgb, flip)) return false;
+
+		return readHeader(cacheFile, size, time, srgb, flip);
+	}
+
+	void TiledImage::setupLevels(int w, int h) {
+		int nLevel = Mipmap::LevelCount(w, h);
+		int tileSize = 1 << logTileSize;
+		int nTiles = 0;
+		levels.resize(nLevel);
+		for (int i = 0; i < nLevel; ++i) {
+			Level& l = levels[i];
+			l.w = w;
+			l.h = h;
+			l.tilesX = (w + tileSize - 1) >> logTileSize;
+			l.tilesY = (h + tileSize - 1) >> logTileSize;
+			l.firstTile = nTiles;
+			nTiles += l.tilesX * l.tilesY;
+
+			//same rounding down rule as mipmap
+			w = w == 1 ? 1 : w >> 1;
+			h = h == 1 ? 1 : h >> 1;
+		}
+
+		vector<atomic<TextureTile*>> t(nTiles);
+		for (int i = 0; i < nTiles; ++i)
+			t[i].store(nullptr);
+		tiles.swap(t);
+	}
+
+	bool TiledImage::readHeader(const string& cacheFile, int64_t size, int64_t time, bool srgb, bool flip) {
+		file.close();
+		file.clear();
+		file.open(cacheFile, ios::binary);
+		if (!file) return false;
+
+		char magic[4];
+		int64_t sourceSize = 0, sourceTime = 0;
+		int header[6];
+		file.read(magic, 4);
+		file.read((char*)&sourceSize, sizeof(int64_t));
+		file.read((char*)&sourceTime, sizeof(int64_t));
+		file.read((char*)header, sizeof(header));
+		if (!file || memcmp(magic, cacheMagic, 4) || sourceSize != size || sourceTime != time ||
+			header[0] != int(srgb) || header[1] != int(flip) || header[2] != int(format) || header[3] != logTileSize ||
+			header[4] <= 0 || header[5] <= 0) {
+			file.close();
+			return false;
+		}
+
+		//conversion may be interrupted, so check size of file before tile table is allocated
+		int64_t offset = file.tellg();
+		file.seekg(0, ios::end);
+		int64_t fileSize = file.tellg();
+		if (TileCount(header[4], header[5], logTileSize) > (fileSize - offset) / tileBytes) {
+			file.close();
+			return false;
+		}
+
+		setupLevels(header[4], header[5]);
+		dataOffset = offset;
+
+		return true;
+	}
+
+	bool TiledImage::createCache(const string& source, const string& cacheFile, int64_t size, int64_t time, bool srgb, bool flip) const {
+		int w, h;
+		vector<Vector3f> data;
+		if (!ImageIO::LoadTexture(source.c_str(), w, h, srgb, flip, data)) return false;
+
+		ofstream out(cacheFile, ios::binary);
+		if (!out) {
+			fprintf(stderr, "Can not write texture cache [%s]\n", cacheFile.c_str());
+			return false;
+		}
+
+		int header[6] = { int(srgb), int(flip), int(format), logTileSize, w, h };
+		out.write(cacheMagic, 4);
+		out.write((const char*)&size, sizeof(int64_t));
+		out.write((const char*)&time, sizeof(int64_t));
+		out.write((const char*)header, sizeof(header));
+
+		//levels are written one by one, so only two levels are in memory
+		int tileSize = 1 << logTileSize;
+		int nLevel = Mipmap::LevelCount(w, h);
+		vector<Vector3f> tile(tileSize * tileSize), next;
+		vector<unsigned char> encoded(tileBytes);
+		for (int level = 0; level < nLevel; ++level) {
+			int tilesX = (w + tileSize - 1) >> logTileSize;
+			int tilesY = (h + tileSize - 1) >> logTileSize;
+			for (int ty = 0; ty < tilesY; ++ty) {
+				for (int tx = 0; tx < tilesX; ++tx) {
+					for (int y = 0; y < tileSize; ++y) {
+						for (int x = 0; x < tileSize; ++x) {
+							int px = tx * tileSize + x;
+							int py = ty * tileSize + y;
+							tile[y * tileSize + x] = (px < w && py < h) ? data[py * w + px] : Vector3f::Zero();
+						}
+					}
+
+					Mipmap::EncodeTexels(format, srgb, &tile[0], tileSize * tileSize, &encoded[0]);
+					out.write((const char*)&encoded[0], tileBytes);
+				}
+			}
+
+			if (level + 1 < nLevel) {
+				int nextW, nextH;
+				Mipmap::Downsample(w, h, data, nextW, nextH, next);
+				data.swap(next);
+				w = nextW;
+				h = nextH;
+			}
+		}
+
+		if (!out) {
+			fprintf(stderr, "Can not write texture cache [%s]\n", cacheFile.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	TextureTile* TiledImage::loadTile(int idx) const {
+		lock_guard<mutex> lock(fileMutex);
+		TextureTile* tile = tiles[idx].load(memory_order_acquire);
+		if (tile) return tile;
+
+		tile = new TextureTile();
+		tile->data = AllocAligned<unsigned char>(tileBytes);
+		tile->bytes = tileBytes;
+		tile->image = this;
+		tile->index = idx;
+		tile->referenced = true;
+		file.seekg(dataOffset + int64_t(idx) * tileBytes);
+		file.read((char*)tile->data, tileBytes);
+		if (!file) {
+			fprintf(stderr, "Texture cache read error\n");
+			file.clear();
+			memset(tile->data, 0, tileBytes);
+		}
+
+		tiles[idx].store(tile, memory_order_release);
+		TextureCache::Insert(tile);
+
+		return tile;
+	}
+
+	TextureCache::Pin::Pin(bool active)
+		:active(active) {
+		if (!active) return;
+		if (pinDepth++ > 0) return;
+
+		if (epochSlot < 0) {
+			epochSlot = nEpochSlots++;
+			if (epochSlot >= maxEpochSlots) {
+				fprintf(stderr, "Too many threads use texture cache\n");
+				exit(1);
+			}
+		}
+
+		//publish epoch before any tile pointer is read
+		epochSlots[epochSlot].epoch.store(epoch.load());
+		atomic_thread_fence(memory_order_seq_cst);
+	}
+
+	TextureCache::Pin::~Pin() {
+		if (!active) return;
+		if (--pinDepth > 0) return;
+
+		epochSlots[epochSlot].epoch.store(0, memory_order_release);
+	}
+
+	void TextureCache::SetBudget(int64_t bytes) {
+		budget = bytes;
+	}
+
+	int64_t TextureCache::GetBudget() {
+		return budget;
+	}
+
+	void TextureCache::SetTileSize(int size) {
+		logTileSize = Clamp(Log2Int(Float(Max(size, 1))), 3, 10);
+	}
+
+	int TextureCache::GetLogTileSize() {
+		return logTileSize;
+	}
+
+	void TextureCache::Enable(bool e) {
+		enabled = e;
+	}
+
+	bool TextureCache::IsEnabled() {
+		return enabled;
+	}
+
+	void TextureCache::Insert(TextureTile* tile) {
+		lock_guard<mutex> lock(cacheMutex);
+		resident.push_back(tile);
+		residentBytes += tile->bytes;
+		if (residentBytes > budget) evict();
+		if (!retired.empty()) reclaim();
+	}
+
+	//clock algorithm, tiles touched since last sweep get a second chance
+	void TextureCache::evict() {
+		uint64_t e = epoch.load();
+		bool evicted = false;
+		int visited = 0;
+		while (residentBytes > budget && resident.size() > 1 && visited < 2 * int(resident.size())) {
+			if (clockHand >= int(resident.size())) clockHand = 0;
+			TextureTile* tile = resident[clockHand];
+			if (tile->referenced.load(memory_order_relaxed)) {
+				tile->referenced.store(false, memory_order_relaxed);
+				clockHand++;
+				visited++;
+				continue;
+			}
+
+			//readers pinned at epoch e or earlier may still hold the tile
+			tile->image->tiles[tile->index].store(nullptr);
+			retired.push_back(make_pair(tile, e));
+			residentBytes -= tile->bytes;
+			resident[clockHand] = resident.back();
+			resident.pop_back();
+			evicted = true;
+		}
+
+		if (evicted) epoch++;
+	}
+
+	void TextureCache::reclaim() {
+		atomic_thread_fence(memory_order_seq_cst);
+		uint64_t minEpoch = UINT64_MAX;
+		int nSlots = Min(int(nEpochSlots), maxEpochSlots);
+		for (int i = 0; i < nSlots; ++i) {
+			uint64_t e = epochSlots[i].epoch.load();
+			if (e && e < minEpoch) minEpoch = e;
+		}
+
+		for (size_t i = 0; i < retired.size();) {
+			if (retired[i].second < minEpoch) {
+				FreeAligned(retired[i].first->data);
+				delete retired[i].first;
+				retired[i] = retired.back();
+				retired.pop_back();
+			}
+			else {
+				++i;
+			}
+		}
+	}
+
+	void TextureCache::Release(const TiledImage* image) {
+		lock_guard<mutex> lock(cacheMutex);
+		for (size_t i = 0; i < resident.size();) {
+			TextureTile* tile = resident[i];
+			if (tile->image == image) {
+				residentBytes -= tile->bytes;
+				FreeAligned(tile->data);
+				delete tile;
+				resident[i] = resident.back();
+				resident.pop_back();
+			}
+			else {
+				++i;
+			}
+		}
+
+		for (size_t i = 0; i < retired.size();) {
+			if (retired[i].first->image == image) {
+				FreeAligned(retired[i].first->data);
+				delete retired[i].first;
+				retired[i] = retired.back();
+				retired.pop_back();
+			}
+			else {
+				++i;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../pol.h"
+#include "mipmap.h"
+#include <atomic>
+#include <mutex>
+#include <fstream>
+
+namespace pol {
+	class TiledImage;
+	struct TextureTile {
+		unsigned char* data;
+		int bytes;
+		const TiledImage* image;
+		int index;
+		//second chance bit of clock eviction
+		atomic<bool> referenced;
+	};
+
+	//pyramid stored in a tiled cache file beside the source image
+	//every level is split into square tiles of same size, tiles are
+	//read on first access and may be evicted by TextureCache at any time
+	class TiledImage {
+		friend class TextureCache;
+
+	private:
+		struct Level {
+			int w, h;
+			int tilesX, tilesY;
+			//index of first tile of this level
+			int firstTile;
+		};
+
+		vector<Level> levels;
+		//resident tiles, null if tile is not in memory
+		mutable vector<atomic<TextureTile*>> tiles;
+		TexelFormat format;
+		const float* decodeTable;
+		int logTileSize;
+		int tileBytes;
+		int64_t dataOffset;
+		mutable ifstream file;
+		//serializes file reading, so one tile is never loaded twice
+		mutable mutex fileMutex;
+
+	public:
+		TiledImage();
+		~TiledImage();
+
+		//convert source to cache file if cache is missing or out of date
+		bool Open(const string& source, bool srgb, bool flip, TexelFormat format);
+
+		int LevelCount() const { return levels.size(); }
+		int Width(int level) const { return levels[level].w; }
+		int Height(int level) const { return levels[level].h; }
+
+		//must be called while current thread is pinned
+		__forceinline Vector3f Texel(int level, int x, int y) const {
+			const Level& l = levels[level];
+			int mask = (1 << logTileSize) - 1;
+			int idx = l.firstTile + (y >> logTileSize) * l.tilesX + (x >> logTileSize);
+			TextureTile* tile = tiles[idx].load(memory_order_acquire);
+			if (!tile) tile = loadTile(idx);
+			if (!tile->referenced.load(memory_order_relaxed))
+				tile->referenced.store(true, memory_order_relaxed);
+
+			int offset = ((y & mask) << logTileSize) + (x & mask);
+			return Mipmap::DecodeTexel(format, decodeTable, tile->data + offset * Mipmap::TexelSize(format));
+		}
+
+	private:
+		TextureTile* loadTile(int idx) const;
+		bool readHeader(const string& cacheFile, int64_t size, int64_t time, bool srgb, bool flip);
+		bool createCache(const string& source, const string& cacheFile, int64_t size, int64_t time, bool srgb, bool flip) const;
+		void setupLevels(int w, int h);
+	};
+
+	//global budget of resident tiles
+	//lookups read resident tiles without lock, tiles are freed with epoch based
+	//reclamation: every reader publishes the epoch it starts with, evicted tiles
+	//are retired and only freed when no reader of an older epoch remains
+	class TextureCache {
+	private:
+		static mutex cacheMutex;
+		static int64_t budget;
+		static int64_t residentBytes;
+		static int logTileSize;
+		static bool enabled;
+		static vector<TextureTile*> resident;
+		static int clockHand;
+		static vector<pair<TextureTile*, uint64_t>> retired;
+		static atomic<uint64_t> epoch;
+
+	public:
+		//keep tiles fetched by current thread alive, can be nested
+		class Pin {
+		private:
+			bool active;
+
+		public:
+			Pin(bool active = true);
+			~Pin();
+		};
+
+		//budget in bytes
+		static void SetBudget(int64_t bytes);
+		static int64_t GetBudget();
+		//tile size must be power of 2
+		static void SetTileSize(int size);
+		static int GetLogTileSize();
+		//images are tiled by default once cache is configured
+		static void Enable(bool e);
+		static bool IsEnabled();
+
+		//add loaded tile, tiles over budget are evicted
+		static void Insert(TextureTile* tile);
+		//drop all tiles of image, no thread may read the image
+		static void Release(const TiledImage* image);
+
+	private:
+		static void evict();
+		static void reclaim();
+	};
+}
\ No newline at end of file
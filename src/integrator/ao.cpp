@@ -13,7 +13,7 @@ namespace pol {
 	//         Li = 1/piV(p)cos(t)dw
 	//where V(p) is visibility function.
 	//V(p) = 1 if visible and 0 otherwise
-	Vector3f Ao::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const {
+	Vector3f Ao::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov) const {
 		Vector3f L(0.f);
 
 		Ray r = ray;
@@ -22,6 +22,12 @@ namespace pol {
 		bool intersect = scene.Intersect(r, isect);
 		if (!intersect) return L;
 
+		//ao has no surface color
+		if (aov) {
+			aov->SetSurface(ray, isect);
+			aov->albedo = Vector3f::One();
+		}
+
 		Vector3f p = isect.p;
 		Vector3f n = isect.n;
 
@@ -10,7 +10,8 @@ namespace pol {
 	public:
 		Ao(const PropSets& props, Scene& scene);
 
-		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const;
+		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov = nullptr) const;
+		virtual bool HasAov() const { return true; }
 
 		virtual string ToString() const;
 	};
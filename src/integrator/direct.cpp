@@ -6,13 +6,13 @@ namespace pol {
 
 	Direct::Direct(const PropSets& props, Scene& scene)
 		:Integrator(props, scene) {
-
+		risCandidates = props.GetInt("risCandidates", 1);
 	}
 
 	//direct integrator is aimed to solve equation 
 	//    Li = Le + Fr*Le*cos(t)*dw
 	//Le is direct illumination from light
-	Vector3f Direct::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const {
+	Vector3f Direct::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov) const {
 		Vector3f L(0.f);
 		Ray r = ray;
 
@@ -27,6 +27,7 @@ namespace pol {
 		Bsdf* bsdf = isect.bsdf;
 
 		if (found) {
+			if (aov) aov->SetSurface(ray, isect);
 			if (isect.light) {
 				//intersect area light?
 				L += isect.light->Le(in, isect.n);
@@ -44,19 +45,33 @@ namespace pol {
 		isect.ComputeDifferentials(ray);
 
 		if (!isect.bsdf->IsDelta()) {
-			//sample light
+			//light choice, light and bsdf dimensions are drawn at once
+			Float uChoice = sampler->Next1D();
+			Vector2f u2D[2];
+			sampler->Next2DArray(u2D, 2);
+
+			//same distribution for light sampling and mis of bsdf sample
 			const Distribution1D* lightDistribution = scene.LightLookup(p);
-			int lightIdx = lightDistribution->SampleDiscrete(sampler->Next1D());
-			Float choicePdf = lightDistribution->DiscretePdf(lightIdx);
-			Light* light = scene.GetLight(lightIdx);
 
+			//sample light
+			Light* light = nullptr;
 			Vector3f radiance;
-			Float lightPdf;
+			Float lightPdf = 0;
 			Ray shadowRay;
-			light->SampleLight(isect, sampler->Next2D(), radiance, lightPdf, shadowRay);
-			if (lightPdf != 0 && !scene.Occluded(shadowRay)) {
+			//reciprocal of light pdf, or weight of resampling in ris mode
+			Float invPdf = 0;
+			if (risCandidates > 1) {
+				light = SampleLightRIS(scene, lightDistribution, isect, localIn, sampler, risCandidates, radiance, lightPdf, shadowRay, invPdf);
+			}
+			else {
+				Float choicePdf;
+				int lightIdx = scene.LightSample(lightDistribution, p, n, uChoice, choicePdf);
+				if (lightIdx >= 0) light = scene.GetLight(lightIdx);
+				if (light) light->SampleLight(isect, u2D[0], radiance, lightPdf, shadowRay);
 				lightPdf *= choicePdf;
-
+				if (lightPdf != 0) invPdf = 1 / lightPdf;
+			}
+			if (lightPdf != 0 && !scene.Occluded(shadowRay)) {
 				Vector3f fr;
 				Float bsdfPdf;
 				Vector3f localOut = isect.shFrame.ToLocal(shadowRay.d);
@@ -69,7 +84,7 @@ namespace pol {
 					if (!light->IsDelta())
 						weight = PowerHeuristic(lightPdf, bsdfPdf);
 
-					L += weight * fr * radiance / lightPdf;
+					L += weight * fr * radiance * invPdf;
 				}
 			}
 
@@ -77,10 +92,12 @@ namespace pol {
 			Vector3f out;
 			Vector3f fr;
 			Float bsdfPdf;
-			bsdf->SampleBsdf(isect, localIn, sampler->Next2D(), out, fr, bsdfPdf);
+			bsdf->SampleBsdf(isect, localIn, u2D[1], out, fr, bsdfPdf);
 			//if (!bsdfPdf) return L;
 			//the above sentence makes a bug, it should not return when bsdfPdf = 0
 			if (bsdfPdf) {
+				//averages to albedo over samples of pixel
+				if (aov) aov->albedo = fr / bsdfPdf;
 				out = isect.shFrame.ToWorld(out);
 				Ray scatterRay(p, out);
 				Intersection scatterIsect;
@@ -91,7 +108,7 @@ namespace pol {
 					if (light) {
 						radiance = light->Le(-out, scatterIsect.n);
 						lightPdf = light->Pdf(scatterIsect, p);
-						lightPdf *= lightDistribution->DiscretePdf(scene.GetLightIndex(light));
+						lightPdf *= scene.LightPdf(lightDistribution, p, n, scene.GetLightIndex(light));
 					}
 					if (!IsBlack(radiance)) {
 						Float weight = PowerHeuristic(bsdfPdf, lightPdf);
@@ -103,7 +120,7 @@ namespace pol {
 					Vector3f radiance = light->Le(-out, Vector3f::Zero());
 					scatterIsect.p = p + out;
 					Float lightPdf = light->Pdf(scatterIsect, p);
-					lightPdf *= lightDistribution->DiscretePdf(scene.GetLightIndex(light));
+					lightPdf *= scene.LightPdf(lightDistribution, p, n, scene.GetLightIndex(light));
 					Float weight = PowerHeuristic(bsdfPdf, lightPdf);
 					L += weight * fr * radiance / bsdfPdf;
 				}
@@ -115,7 +132,8 @@ namespace pol {
 
 	string Direct::ToString() const {
 		string ret;
-		ret += "Direct[\n]";
+		ret += "Direct[\n  risCandidates = " + to_string(risCandidates)
+			+ "\n]";
 
 		return ret;
 	}
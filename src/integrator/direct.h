@@ -4,10 +4,15 @@
 
 namespace pol {
 	class Direct : public Integrator {
+	private:
+		//number of candidates for resampled light sampling, disabled if not greater than 1
+		int risCandidates;
+
 	public:
 		Direct(const PropSets& props, Scene& scene);
 
-		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const;
+		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov = nullptr) const;
+		virtual bool HasAov() const { return true; }
 
 		virtual string ToString() const;
 	};
@@ -12,7 +12,7 @@ namespace pol {
 		rrDepth = props.GetInt("rrDepth", 3);
 	}
 
-	Vector3f LTrace::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const {
+	Vector3f LTrace::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov) const {
 		return 0;
 	}
 
@@ -37,18 +37,22 @@ namespace pol {
 		vector<RenderBlock> rbs;
 		InitRenderBlock(scene, rbs);
 
+		ThreadSamplers samplers(sampler);
 		Parallel::ParallelLoop([&](const RenderBlock& rb) {
-			Sampler* samplerClone = sampler->Clone();
+			Sampler* samplerClone = samplers.Get();
+			vector<CameraSample> cameraSamples(nSamples);
 			int sx = rb.sx, sy = rb.sy;
 			int ex = rb.sx + rb.w, ey = rb.sy + rb.h;
 			for (int i = sx; i < ex; ++i) {
 				for (int j = sy; j < ey; ++j) {
 					samplerClone->Prepare(j * film->res.x + i);
+					samplerClone->GetCameraSamples(&cameraSamples[0], nSamples);
 					for (int s = 0; s < nSamples; ++s) {
+						samplerClone->SetSampleIndex(s);
 						//get radiance directly from light 
-						Vector2f offset = samplerClone->Next2D() - Vector2f(0.5);
+						Vector2f offset = cameraSamples[s].film - Vector2f(0.5);
 						Vector2f sample = Vector2f(i, j) + offset;
-						RayDifferential primaryRay = camera->GenerateRayDifferential(sample, samplerClone->Next2D());
+						RayDifferential primaryRay = camera->GenerateRayDifferential(sample, cameraSamples[s].lens);
 						Intersection lightIsect;
 						if (scene.Intersect(primaryRay, lightIsect)) {
 							if (lightIsect.light) {
@@ -63,7 +67,7 @@ namespace pol {
 							}
 						}
 
-						int lightIndex = lightDistribution->SampleDiscrete(samplerClone->Next1D());
+						int lightIndex = lightDistribution->SampleAliasDiscrete(samplerClone->Next1D());
 						Float choicePdf = lightDistribution->DiscretePdf(lightIndex);
 						Light* light = scene.GetLight(lightIndex);
 						Float pdfA, pdfW;
@@ -111,15 +115,16 @@ namespace pol {
 
 							if (bounces > rrDepth) {
 								Float luminance = Clamp(1 - GetLuminance(beta), Float(0), Float(1));
-								if (sampler->Next1D() < luminance) break;
+								if (samplerClone->Next1D() < luminance) break;
 								beta /= (1 - luminance);
 							}
 						}
 					}
 				}
 			}
-
 			}, rbs);
+		//samplers are released at the end of scope
+		Parallel::WaitUntilTaskFinish();
 	}
 
 	string LTrace::ToString() const {
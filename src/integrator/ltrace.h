@@ -11,7 +11,7 @@ namespace pol {
 	public:
 		LTrace(const PropSets& props, Scene& scene);
 
-		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const;
+		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov = nullptr) const;
 		virtual void Render(const Scene& scene) const;
 		virtual bool IsBidirectional() const { return true; }
 
@@ -1,5 +1,6 @@
 #include "path.h"
 #include "../core/scene.h"
+#include "../core/parallel.h"
 
 namespace pol {
 	POL_REGISTER_CLASS(Path, "path");
@@ -9,17 +10,39 @@ namespace pol {
 		maxDepth = props.GetInt("maxDepth", 65536);
 		if (maxDepth == -1) maxDepth = 65536;
 		rrDepth = props.GetInt("rrDepth", 3);
+		guiding = props.GetBool("guiding", false);
+		bsdfSamplingFraction = props.GetFloat("bsdfSamplingFraction", 0.5);
+		risCandidates = props.GetInt("risCandidates", 1);
+		sdTree = nullptr;
+		training = false;
 	}
 
+	Path::~Path() {
+		POL_SAFE_DELETE(sdTree);
+	}
+
+	//path vertex recorded for training guiding structure
+	struct GuidingVertex {
+		SDTree::DTreeWrapper* dTree;
+		Vector3f dir;
+		//throughput after scattering at this vertex
+		Vector3f throughput;
+		Vector3f radiance;
+		Float woPdf;
+	};
+
+	static const int MaxGuidingVertices = 32;
+
 	//path integrator is aimed to solve equation 
 	//    Li = Le + Fr*Li*cos(t)*dw
 	//Le is direct illumination from light
-	Vector3f Path::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const {
+	Vector3f Path::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov) const {
 		Vector3f L(0.f);
 		Vector3f beta(1);
 		Ray r = ray;
 		Intersection isect;
 		if (scene.Intersect(r, isect)) {
+			if (aov) aov->SetSurface(ray, isect);
 			//intersect with light?
 			if (isect.light) {
 				return beta * isect.light->Le(-r.d, isect.n);
@@ -34,6 +57,18 @@ namespace pol {
 			return L;
 		}
 
+		GuidingVertex vertices[MaxGuidingVertices];
+		int nVertices = 0;
+		//radiance arriving at recorded vertices
+		auto addRadiance = [&](const Vector3f& c, int n) {
+			for (int k = 0; k < n; ++k) {
+				const Vector3f& t = vertices[k].throughput;
+				vertices[k].radiance += Vector3f(t.X() > 0 ? c.X() / t.X() : 0,
+					t.Y() > 0 ? c.Y() / t.Y() : 0,
+					t.Z() > 0 ? c.Z() / t.Z() : 0);
+			}
+		};
+
 		for (int bounces = 0; bounces < maxDepth; ++bounces) {
 			Vector3f in = -r.d;
 			Vector3f localIn = isect.shFrame.ToLocal(in);
@@ -53,27 +88,53 @@ namespace pol {
 				isect.dudy = isect.dvdy = 0;
 			}
 
+			//guiding is only used on non-delta surface
+			SDTree::DTreeWrapper* dTree = nullptr;
+			if (sdTree && !bsdf->IsDelta()) dTree = sdTree->Lookup(p);
+			bool guided = dTree && sdTree->IsTrained();
+
+			//dimensions of a bounce are drawn at once, each one has a fixed slot,
+			//so a bounce uses the same dimensions whichever branch it takes
+			//1D: light choice, guiding choice, bssrdf, russian roulette
+			//2D: light, bsdf or guiding, bssrdf
+			Float u1D[4];
+			Vector2f u2D[3];
+			sampler->Next1DArray(u1D, 4);
+			sampler->Next2DArray(u2D, 3);
+
+			//same distribution for light sampling here and mis of next hit
 			const Distribution1D* lightDistribution = scene.LightLookup(p);
+
 			//estimate direct lighting
 			if (!bsdf->IsDelta()) {
 				//sample light
-				int lightIdx = lightDistribution->SampleDiscrete(sampler->Next1D());
-				Float choicePdf = lightDistribution->DiscretePdf(lightIdx);
-				Light* light = scene.GetLight(lightIdx);
-
+				Light* light = nullptr;
 				Vector3f radiance;
-				Float lightPdf;
+				Float lightPdf = 0;
 				Ray shadowRay;
-				light->SampleLight(isect, sampler->Next2D(), radiance, lightPdf, shadowRay);
-				if (lightPdf != 0 && !scene.Occluded(shadowRay)) {
+				//reciprocal of light pdf, or weight of resampling in ris mode
+				Float invPdf = 0;
+				if (risCandidates > 1) {
+					light = SampleLightRIS(scene, lightDistribution, isect, localIn, sampler, risCandidates, radiance, lightPdf, shadowRay, invPdf);
+				}
+				else {
+					Float choicePdf;
+					int lightIdx = scene.LightSample(lightDistribution, p, n, u1D[0], choicePdf);
+					if (lightIdx >= 0) light = scene.GetLight(lightIdx);
+					if (light) light->SampleLight(isect, u2D[0], radiance, lightPdf, shadowRay);
 					lightPdf *= choicePdf;
-
+					if (lightPdf != 0) invPdf = 1 / lightPdf;
+				}
+				if (lightPdf != 0 && !scene.Occluded(shadowRay)) {
 					Vector3f fr;
 					Float bsdfPdf;
 					Vector3f localOut = isect.shFrame.ToLocal(shadowRay.d);
 					//here infinite light can easily make bsdfPdf = 0
 					//because it choose point on whole sphere randomly
 					bsdf->Fr(isect, localIn, localOut, fr, bsdfPdf);
+					if (guided) {
+						bsdfPdf = bsdfSamplingFraction * bsdfPdf + (1 - bsdfSamplingFraction) * dTree->Pdf(shadowRay.d);
+					}
 
 					if (bsdfPdf != 0) {
 						Float weight = 1;
@@ -81,19 +142,62 @@ namespace pol {
 						if (!light->IsDelta())
 							weight = PowerHeuristic(lightPdf, bsdfPdf);
 
-						L += beta * weight * fr * radiance / lightPdf;
+						Vector3f c = beta * weight * fr * radiance * invPdf;
+						L += c;
+						addRadiance(c, nVertices);
 					}
 				}
 			}
 
-			//bsdf sampling
 			Vector3f out, fr;
 			Float bsdfPdf;
-			bsdf->SampleBsdf(isect, localIn, sampler->Next2D(), out, fr, bsdfPdf);
-			if (bsdfPdf == 0) break;
+			if (guided) {
+				//one-sample mis between bsdf and guiding distribution
+				if (u1D[1] < bsdfSamplingFraction) {
+					bsdf->SampleBsdf(isect, localIn, u2D[1], out, fr, bsdfPdf);
+					if (bsdfPdf == 0) break;
+
+					out = isect.shFrame.ToWorld(out);
+				}
+				else {
+					out = dTree->Sample(u2D[1]);
+				}
+
+				bsdf->Fr(isect, localIn, isect.shFrame.ToLocal(out), fr, bsdfPdf);
+				bsdfPdf = bsdfSamplingFraction * bsdfPdf + (1 - bsdfSamplingFraction) * dTree->Pdf(out);
+				if (bsdfPdf == 0 || IsBlack(fr)) break;
+			}
+			else {
+				//bsdf sampling
+				bsdf->SampleBsdf(isect, localIn, u2D[1], out, fr, bsdfPdf);
+				if (bsdfPdf == 0) break;
+
+				//transform out direction from local coordinate to world coordinate
+				out = isect.shFrame.ToWorld(out);
+			}
+
+			//fr/pdf of first bounce averages to albedo over samples of pixel,
+			//whichever lobe is chosen
+			if (aov && bounces == 0) aov->albedo = fr / bsdfPdf;
+
+			if (dTree && training && nVertices < MaxGuidingVertices) {
+				vertices[nVertices++] = { dTree, out, beta * fr / bsdfPdf, Vector3f::Zero(), bsdfPdf };
+			}
 
-			//transform out direction from local coordinate to world coordinate
-			out = isect.shFrame.ToWorld(out);
+			//light transmitted into subsurface medium exits at another point,
+			//the exit point is sampled by bssrdf and the path continues from there
+			if (isect.bssrdf && Dot(out, n) * Dot(in, n) < 0) {
+				beta *= fr / bsdfPdf;
+				Intersection probeIsect;
+				Float pdf;
+				Vector3f s = isect.bssrdf->SampleS(scene, isect, u1D[2], u2D[2], probeIsect, pdf);
+				if (IsBlack(s) || pdf == 0) break;
+
+				beta *= s / pdf;
+				isect = probeIsect;
+				r = Ray(isect.p + isect.n, -isect.n);
+				continue;
+			}
 
 			//trace a next ray
 			r = Ray(p, out);
@@ -106,13 +210,15 @@ namespace pol {
 					Float lightPdf = 0;
 					radiance = light->Le(-out, isect.n);
 					lightPdf = light->Pdf(isect, p);
-					lightPdf *= lightDistribution->DiscretePdf(scene.GetLightIndex(light));
+					lightPdf *= scene.LightPdf(lightDistribution, p, n, scene.GetLightIndex(light));
 					if (!IsBlack(radiance)) {
 						Float weight = 1;
 						//delta bsdf has weight 1
 						if(!bsdf->IsDelta())
 						    weight = PowerHeuristic(bsdfPdf, lightPdf);
-						L += beta * weight * fr * radiance / bsdfPdf;
+						Vector3f c = beta * weight * fr * radiance / bsdfPdf;
+						L += c;
+						addRadiance(c, nVertices);
 					}
 
 					break;
@@ -125,12 +231,14 @@ namespace pol {
 					Vector3f radiance = light->Le(-out, Vector3f::Zero());
 					isect.p = p + out;
 					Float lightPdf = light->Pdf(isect, p);
-					lightPdf *= lightDistribution->DiscretePdf(scene.GetLightIndex(light));
+					lightPdf *= scene.LightPdf(lightDistribution, p, n, scene.GetLightIndex(light));
 					Float weight = 1;
 					//delta bsdf has weight 1
 					if (!bsdf->IsDelta())
 						weight = PowerHeuristic(bsdfPdf, lightPdf);
-					L += beta * weight * fr * radiance / bsdfPdf;
+					Vector3f c = beta * weight * fr * radiance / bsdfPdf;
+					L += c;
+					addRadiance(c, nVertices);
 				}
 
 				break;
@@ -148,18 +256,134 @@ namespace pol {
 			//   E[y] = E[f(x)] - pc + pc = E[f(x)]
 			if (bounces > rrDepth) {
 				Float luminance = Clamp(1 - GetLuminance(beta), Float(0), Float(1));
-				if (sampler->Next1D() < luminance) break;
+				if (u1D[3] < luminance) break;
 				beta /= (1 - luminance);
 			}
 		}
 
+		//incident radiance weighted by 1/pdf is recorded
+		for (int k = 0; k < nVertices; ++k) {
+			vertices[k].dTree->Record(vertices[k].dir, GetLuminance(vertices[k].radiance) / vertices[k].woPdf);
+		}
+
 		return L;
 	}
 
+	//render in passes of doubling sample count, guiding structure is
+	//refined after each pass and the last pass only uses it
+	//passes are combined by inverse of their variance, so early passes with
+	//poor guiding add little noise. variance of a pass is the mean variance of
+	//its pixel estimates, which needs at least 2 samples, so 1 spp pass only
+	//trains the guiding structure unless it is the only pass
+	void Path::Render(const Scene& scene) const {
+		Camera* camera = scene.GetCamera();
+		Film* film = camera->GetFilm();
+		const Sampler* sampler = scene.GetSampler();
+		int sampleCount = sampler->GetSampleCount();
+		int nPixels = film->res.x * film->res.y;
+
+		POL_SAFE_DELETE(sdTree);
+		sdTree = new SDTree(scene.GetBBox());
+
+		vector<RenderBlock> rbs;
+		InitRenderBlock(scene, rbs);
+
+		ThreadSamplers samplers(sampler);
+		//sum of passes weighted by inverse variance
+		vector<Vector3f> combined(nPixels, Vector3f::Zero());
+		double weightSum = 0;
+		//sum of colors and squared luminance of current pass
+		vector<Vector3f> passColor(nPixels);
+		vector<Float> passLumSq(nPixels);
+		int spp = 1, finished = 0;
+		for (int pass = 0; finished < sampleCount; ++pass, spp *= 2) {
+			//if remaining samples are not enough for next pass, render them all
+			int passSamples = sampleCount - finished;
+			if (passSamples >= 3 * spp) passSamples = spp;
+			training = finished + passSamples < sampleCount;
+
+			Parallel::ParallelLoop([&](const RenderBlock& rb) {
+				Sampler* samplerClone = samplers.Get();
+				vector<CameraSample> cameraSamples(passSamples);
+				int sx = rb.sx, sy = rb.sy;
+				int ex = rb.sx + rb.w, ey = rb.sy + rb.h;
+				for (int i = sx; i < ex; ++i) {
+					for (int j = sy; j < ey; ++j) {
+						samplerClone->Prepare(uint64_t(pass) * nPixels + j * film->res.x + i);
+						samplerClone->GetCameraSamples(&cameraSamples[0], passSamples);
+						Vector3f color(0.f);
+						Float lumSq = 0;
+						for (int s = 0; s < passSamples; ++s) {
+							samplerClone->SetSampleIndex(s);
+							Vector2f offset = cameraSamples[s].film - Vector2f(0.5);
+							Vector2f sample = Vector2f(i, j) + offset;
+							RayDifferential ray = camera->GenerateRayDifferential(sample, cameraSamples[s].lens);
+
+							Vector3f c;
+							if (film->HasAov()) {
+								AovSample aov;
+								c = Li(ray, scene, samplerClone, &aov);
+								film->AddAov(Vector2i(i, j), aov.albedo, aov.normal, aov.depth);
+							}
+							else {
+								c = Li(ray, scene, samplerClone);
+							}
+							color += c;
+							lumSq += GetLuminance(c) * GetLuminance(c);
+						}
+
+						//each pixel is rendered by only one thread
+						passColor[j * film->res.x + i] = color;
+						passLumSq[j * film->res.x + i] = lumSq;
+					}
+				}
+				}, rbs);
+			Parallel::WaitUntilTaskFinish();
+
+			if (training) sdTree->Refine();
+			finished += passSamples;
+
+			double weight = 0;
+			if (passSamples > 1) {
+				//mean variance of pixel estimates of this pass
+				double variance = 0;
+				for (int i = 0; i < nPixels; ++i) {
+					double lum = GetLuminance(passColor[i]);
+					variance += (passLumSq[i] - lum * lum / passSamples) / (double(passSamples) * (passSamples - 1));
+				}
+				weight = 1 / Max(variance / nPixels, 1e-12);
+			}
+			else if (!training) {
+				//only pass
+				weight = 1;
+			}
+
+			if (weight > 0) {
+				for (int i = 0; i < nPixels; ++i) {
+					combined[i] += passColor[i] * Float(weight / passSamples);
+				}
+				weightSum += weight;
+			}
+
+			//film keeps sum of samples, so combined mean is scaled by sample count
+			//last pass is written by scene
+			if (weightSum > 0 && (!training || film->progressiveOutput)) {
+				Float scale = Float(finished / weightSum);
+				for (int i = 0; i < nPixels; ++i) {
+					film->AddPixel(i, combined[i] * scale);
+				}
+				if (training) film->WriteImageAsync(Float(1) / finished);
+			}
+		}
+	}
+
 	string Path::ToString() const {
 		string ret;
 		ret += "Path[\n  maxDepth = " + to_string(maxDepth)
 			+ ",\n  rrDepth = " + to_string(rrDepth)
+			+ ",\n  guiding = " + (guiding ? "true" : "false")
+			+ ",\n  bsdfSamplingFraction = " + to_string(bsdfSamplingFraction)
+			+ ",\n  risCandidates = " + to_string(risCandidates)
 			+ "\n]";
 
 		return ret;
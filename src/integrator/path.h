@@ -1,17 +1,30 @@
 #pragma once
 
 #include "../core/integrator.h"
+#include "../core/guiding.h"
 
 namespace pol {
 	class Path : public Integrator {
 	private:
 		int maxDepth;
 		int rrDepth;
+		//learn incident radiance and guide sampling
+		bool guiding;
+		//probability of sampling bsdf instead of guiding structure
+		Float bsdfSamplingFraction;
+		//number of candidates for resampled light sampling, disabled if not greater than 1
+		int risCandidates;
+		mutable SDTree* sdTree;
+		mutable bool training;
 
 	public:
 		Path(const PropSets& props, Scene& scene);
+		virtual ~Path();
 
-		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler) const;
+		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov = nullptr) const;
+		virtual bool HasAov() const { return true; }
+		virtual void Render(const Scene& scene) const;
+		virtual bool IsProgressive() const { return guiding; }
 
 		virtual string ToString() const;
 	};
@@ -0,0 +1,348 @@
+#include "sppm.h"
+#include "../core/scene.h"
+
+namespace pol {
+	POL_REGISTER_CLASS(SPPM, "sppm");
+
+	SPPM::SPPM(const PropSets& props, Scene& scene)
+		:Integrator(props, scene) {
+		maxDepth = props.GetInt("maxDepth", 65536);
+		if (maxDepth == -1) maxDepth = 65536;
+		iterations = props.GetInt("iterations", -1);
+		photonsPerIteration = props.GetInt("photonsPerIteration", -1);
+		initialRadius = props.GetFloat("initialRadius", 1);
+		alpha = props.GetFloat("alpha", 0.7);
+	}
+
+	Vector3f SPPM::Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov) const {
+		return 0;
+	}
+
+	static __forceinline bool ToGrid(const Vector3f& p, const BBox& bounds, const int gridRes[3], int pi[3]) {
+		bool inBounds = true;
+		Vector3f pg = (p - bounds.fmin) / bounds.Diagonal();
+		Float pf[3] = { pg.X(), pg.Y(), pg.Z() };
+		for (int i = 0; i < 3; ++i) {
+			pi[i] = int(gridRes[i] * pf[i]);
+			inBounds &= (pi[i] >= 0 && pi[i] < gridRes[i]);
+			pi[i] = Clamp(pi[i], 0, gridRes[i] - 1);
+		}
+
+		return inBounds;
+	}
+
+	static __forceinline unsigned int HashGrid(const int pi[3], int hashSize) {
+		return (unsigned int)((pi[0] * 73856093) ^ (pi[1] * 19349663) ^ (pi[2] * 83492791)) % hashSize;
+	}
+
+	//the pixel estimate after i iterations is given by
+	//    L = Ld/i + tau/(i*Np*PI*r^2)
+	//Ld is the direct lighting at visible point and tau is the accumulated flux
+	//radius and flux are updated by
+	//    N' = N + alpha*M
+	//    r' = r*sqrt(N'/(N + M))
+	//    tau' = (tau + beta*phi)*r'^2/r^2
+	void SPPM::Render(const Scene& scene) const {
+		Camera* camera = scene.GetCamera();
+		Film* film = camera->GetFilm();
+		const Sampler* sampler = scene.GetSampler();
+		int nPixels = film->res.x * film->res.y;
+		int nIterations = iterations > 0 ? iterations : sampler->GetSampleCount();
+		int nPhotons = photonsPerIteration > 0 ? photonsPerIteration : nPixels;
+
+		vector<SPPMPixel> pixels(nPixels);
+		for (SPPMPixel& pixel : pixels) pixel.radius = initialRadius;
+
+		//hash grid, one bucket per pixel
+		//cell width is not less than diameter of the largest radius,
+		//so a visible point can overlap 8 cells at most, the node pool never grows
+		vector<atomic<SPPMPixelNode*>> grid(nPixels);
+		vector<SPPMPixelNode> nodes(8 * nPixels);
+		atomic<int> nodeCount = 0;
+		for (atomic<SPPMPixelNode*>& head : grid) head = nullptr;
+
+		//per thread data, the first one is for the calling thread
+		int nThreads = Parallel::GetNumWorkingThreads();
+		ThreadSamplers samplers(sampler);
+		vector<BBox> threadBounds(nThreads + 1);
+		vector<Float> threadRadius(nThreads + 1);
+
+		for (int iter = 0; iter < nIterations; ++iter) {
+			//generate visible points
+			Parallel::ParallelFor([&](int j) {
+				Sampler* samplerClone = samplers.Get();
+				for (int i = 0; i < film->res.x; ++i) {
+					int pixelIndex = j * film->res.x + i;
+					samplerClone->Prepare(uint64_t(iter) * nPixels + pixelIndex);
+					CameraSample cameraSample;
+					samplerClone->GetCameraSamples(&cameraSample, 1);
+					samplerClone->SetSampleIndex(0);
+					Vector2f offset = cameraSample.film - Vector2f(0.5);
+					Vector2f sample = Vector2f(i, j) + offset;
+					RayDifferential ray = camera->GenerateRayDifferential(sample, cameraSample.lens);
+
+					TraceCameraPath(scene, samplerClone, ray, pixels[pixelIndex]);
+				}
+				}, film->res.y);
+
+			//compute grid bounds
+			for (int t = 0; t <= nThreads; ++t) {
+				threadBounds[t].Reset();
+				threadRadius[t] = 0;
+			}
+			Parallel::ParallelFor([&](int c) {
+				int t = Parallel::GetThreadIndex() + 1;
+				int end = Min(nPixels, (c + 1) * 4096);
+				for (int i = c * 4096; i < end; ++i) {
+					const SPPMPixel& pixel = pixels[i];
+					if (IsBlack(pixel.beta)) continue;
+
+					Vector3f r(pixel.radius);
+					threadBounds[t].Union(pixel.isect.p - r);
+					threadBounds[t].Union(pixel.isect.p + r);
+					threadRadius[t] = Max(threadRadius[t], pixel.radius);
+				}
+				}, (nPixels + 4095) / 4096);
+
+			BBox gridBounds;
+			Float maxRadius = 0;
+			for (int t = 0; t <= nThreads; ++t) {
+				gridBounds.Union(threadBounds[t]);
+				maxRadius = Max(maxRadius, threadRadius[t]);
+			}
+
+			//no visible point can receive photons
+			if (maxRadius > 0) {
+				Vector3f diag = gridBounds.Diagonal();
+				Float d[3] = { diag.X(), diag.Y(), diag.Z() };
+				int gridRes[3];
+				for (int i = 0; i < 3; ++i) {
+					//round down, so cell width is at least 2 * maxRadius
+					gridRes[i] = Clamp(int(d[i] / (2 * maxRadius)), 1, 1 << 20);
+				}
+
+				//add visible points to grid
+				Parallel::ParallelFor([&](int i) {
+					SPPMPixel& pixel = pixels[i];
+					if (IsBlack(pixel.beta)) return;
+
+					Vector3f r(pixel.radius);
+					int pMin[3], pMax[3];
+					ToGrid(pixel.isect.p - r, gridBounds, gridRes, pMin);
+					ToGrid(pixel.isect.p + r, gridBounds, gridRes, pMax);
+					for (int z = pMin[2]; z <= pMax[2]; ++z) {
+						for (int y = pMin[1]; y <= pMax[1]; ++y) {
+							for (int x = pMin[0]; x <= pMax[0]; ++x) {
+								int cell[3] = { x, y, z };
+								atomic<SPPMPixelNode*>& head = grid[HashGrid(cell, nPixels)];
+								//pool is sized for 8 cells per point, never write past it
+								int nodeIndex = nodeCount++;
+								if (nodeIndex >= int(nodes.size())) continue;
+
+								SPPMPixelNode* node = &nodes[nodeIndex];
+								node->pixel = &pixel;
+								//push front without lock
+								node->next = head;
+								while (!head.compare_exchange_weak(node->next, node));
+							}
+						}
+					}
+					}, nPixels, 256);
+
+				//trace photons
+				uint64_t photonSeed = uint64_t(nIterations) * nPixels + uint64_t(iter) * nPhotons;
+				Parallel::ParallelFor([&](int k) {
+					Sampler* samplerClone = samplers.Get();
+					samplerClone->Prepare(photonSeed + k);
+
+					TracePhoton(scene, samplerClone, gridBounds, gridRes, grid);
+					}, nPhotons, 1024);
+			}
+
+			//update pixel statistics and clear grid
+			Parallel::ParallelFor([&](int i) {
+				SPPMPixel& pixel = pixels[i];
+				grid[i] = nullptr;
+
+				int M = pixel.M;
+				if (M > 0) {
+					Float N = pixel.N + alpha * M;
+					Float radius = pixel.radius * sqrt(N / (pixel.N + M));
+					Vector3f phi(pixel.phi[0], pixel.phi[1], pixel.phi[2]);
+					pixel.tau = (pixel.tau + pixel.beta * phi) * (radius * radius) / (pixel.radius * pixel.radius);
+					pixel.N = N;
+					pixel.radius = radius;
+					pixel.M = 0;
+					for (int c = 0; c < 3; ++c) pixel.phi[c] = 0;
+				}
+				}, nPixels, 256);
+			nodeCount = 0;
+
+			printf("Rendering Progress[%.3f%%]\r", Float(iter + 1) / nIterations * 100);
+		}
+
+		//film is normalized by sample count of sampler when writing
+		Float scale = Float(sampler->GetSampleCount());
+		for (int i = 0; i < nPixels; ++i) {
+			const SPPMPixel& pixel = pixels[i];
+			Vector3f L = pixel.Ld / Float(nIterations);
+			L += pixel.tau / (Float(nIterations) * nPhotons * PI * pixel.radius * pixel.radius);
+			film->AddPixel(i, L * scale);
+		}
+	}
+
+	//trace camera path until a non-delta surface is found,
+	//direct lighting is estimated there and the surface becomes visible point
+	void SPPM::TraceCameraPath(const Scene& scene, const Sampler* sampler, RayDifferential& ray, SPPMPixel& pixel) const {
+		pixel.beta = Vector3f::Zero();
+
+		Vector3f beta(1);
+		Ray r = ray;
+		for (int bounces = 0; bounces < maxDepth; ++bounces) {
+			Intersection isect;
+			if (!scene.Intersect(r, isect)) {
+				//intersect nothing, maybe infinite light exists
+				Light* light = scene.GetInfiniteLight();
+				if (light) pixel.Ld += beta * light->Le(-r.d, Vector3f::Zero());
+
+				break;
+			}
+
+			//intersect with light?
+			if (isect.light) {
+				pixel.Ld += beta * isect.light->Le(-r.d, isect.n);
+				break;
+			}
+
+			if (bounces == 0) {
+				//prepare differentials
+				isect.ComputeDifferentials(ray);
+			}
+
+			//dimensions of a bounce are drawn at once
+			//1D: light choice, 2D: light, bsdf
+			Float uChoice = sampler->Next1D();
+			Vector2f u2D[2];
+			sampler->Next2DArray(u2D, 2);
+
+			Vector3f localIn = isect.shFrame.ToLocal(-r.d);
+			Bsdf* bsdf = isect.bsdf;
+			if (!bsdf->IsDelta()) {
+				//estimate direct lighting
+				Float choicePdf;
+				int lightIdx = scene.LightSample(scene.LightLookup(isect.p), isect.p, isect.n, uChoice, choicePdf);
+				Light* light = lightIdx >= 0 ? scene.GetLight(lightIdx) : nullptr;
+
+				Vector3f radiance;
+				Float lightPdf = 0;
+				Ray shadowRay;
+				if (light) light->SampleLight(isect, u2D[0], radiance, lightPdf, shadowRay);
+				if (lightPdf != 0 && !scene.Occluded(shadowRay)) {
+					Vector3f fr;
+					Float bsdfPdf;
+					Vector3f localOut = isect.shFrame.ToLocal(shadowRay.d);
+					bsdf->Fr(isect, localIn, localOut, fr, bsdfPdf);
+					if (bsdfPdf != 0) pixel.Ld += beta * fr * radiance / (lightPdf * choicePdf);
+				}
+
+				//store visible point
+				pixel.isect = isect;
+				pixel.localIn = localIn;
+				pixel.beta = beta;
+				break;
+			}
+
+			//specular bounce
+			Vector3f out, fr;
+			Float bsdfPdf;
+			bsdf->SampleBsdf(isect, localIn, u2D[1], out, fr, bsdfPdf);
+			if (bsdfPdf == 0) break;
+
+			beta *= fr / bsdfPdf;
+			r = Ray(isect.p, isect.shFrame.ToWorld(out));
+		}
+	}
+
+	//photons are shot from light like light tracing,
+	//every hit except the first one adds flux to nearby visible points
+	void SPPM::TracePhoton(const Scene& scene, const Sampler* sampler, const BBox& gridBounds, const int gridRes[3],
+		const vector<atomic<SPPMPixelNode*>>& grid) const {
+		const Distribution1D* lightDistribution = scene.LightLookup(Vector3f::Zero());
+		int lightIndex = lightDistribution->SampleAliasDiscrete(sampler->Next1D());
+		Float choicePdf = lightDistribution->DiscretePdf(lightIndex);
+		Light* light = scene.GetLight(lightIndex);
+		Float pdfA, pdfW;
+		Vector3f radiance, normal;
+		Ray emitRay;
+		//position and direction
+		Vector2f uEmit[2];
+		sampler->Next2DArray(uEmit, 2);
+		light->SampleLight(uEmit[0], uEmit[1], radiance, normal, emitRay, pdfW, pdfA);
+		if (pdfA == 0 || pdfW == 0) return;
+		Vector3f beta = radiance * fabs(Dot(normal, emitRay.d)) / (pdfA * pdfW * choicePdf);
+		if (IsBlack(beta)) return;
+
+		Ray ray = emitRay;
+		for (int bounces = 0; bounces < maxDepth; ++bounces) {
+			Intersection isect;
+			if (!scene.Intersect(ray, isect)) break;
+
+			//direct lighting is computed in camera pass
+			int cell[3];
+			if (bounces > 0 && ToGrid(isect.p, gridBounds, gridRes, cell)) {
+				unsigned int h = HashGrid(cell, grid.size());
+				for (SPPMPixelNode* node = grid[h]; node != nullptr; node = node->next) {
+					SPPMPixel& pixel = *node->pixel;
+					Float radius = pixel.radius;
+					if ((pixel.isect.p - isect.p).LengthSquare() > radius * radius) continue;
+
+					Vector3f localOut = pixel.isect.shFrame.ToLocal(-ray.d);
+					Float cosOut = Frame::AbsCosTheta(localOut);
+					Vector3f fr;
+					Float pdf;
+					pixel.isect.bsdf->Fr(pixel.isect, pixel.localIn, localOut, fr, pdf);
+					if (pdf == 0 || cosOut == 0) continue;
+
+					//Fr contains cosine term
+					Vector3f phi = beta * fr / cosOut;
+					pixel.phi[0].Add(phi.X());
+					pixel.phi[1].Add(phi.Y());
+					pixel.phi[2].Add(phi.Z());
+					pixel.M++;
+				}
+			}
+
+			//one bsdf and one russian roulette dimension per bounce, drawn at
+			//start of bounce so every bounce uses the same dimensions
+			Vector2f uBsdf = sampler->Next2D();
+			Float uRR = sampler->Next1D();
+
+			Vector3f localIn = isect.shFrame.ToLocal(-ray.d);
+			Vector3f out, fr;
+			Float pdf;
+			isect.bsdf->SampleBsdf(isect, localIn, uBsdf, out, fr, pdf);
+			if (pdf == 0) break;
+			beta *= fr / pdf;
+
+			ray = Ray(isect.p, isect.shFrame.ToWorld(out));
+
+			if (bounces > 3) {
+				Float luminance = Clamp(1 - GetLuminance(beta), Float(0), Float(1));
+				if (uRR < luminance) break;
+				beta /= (1 - luminance);
+			}
+		}
+	}
+
+	string SPPM::ToString() const {
+		string ret;
+		ret += "SPPM[\n  maxDepth = " + to_string(maxDepth)
+			+ ",\n  iterations = " + to_string(iterations)
+			+ ",\n  photonsPerIteration = " + to_string(photonsPerIteration)
+			+ ",\n  initialRadius = " + to_string(initialRadius)
+			+ ",\n  alpha = " + to_string(alpha)
+			+ "\n]";
+
+		return ret;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../core/integrator.h"
+#include "../core/intersection.h"
+#include "../core/parallel.h"
+#include <atomic>
+
+namespace pol {
+	//stochastic progressive photon mapping
+	//each iteration traces one camera path per pixel to find a visible point,
+	//then shoots photons and gathers them at visible points which are stored
+	//in a lock-free hash grid, at last radius of every pixel is shrunk
+	//memory is bounded by pixel count instead of photon count
+	class SPPM : public Integrator {
+	private:
+		struct SPPMPixel {
+			//visible point
+			Intersection isect;
+			Vector3f localIn;
+			Vector3f beta;
+			//radius of photon gather
+			Float radius;
+			//direct lighting accumulated from all iterations
+			Vector3f Ld;
+			//photon statistics
+			AtomicFloat phi[3];
+			atomic<int> M;
+			Float N;
+			Vector3f tau;
+
+			SPPMPixel() :localIn(0), beta(0), radius(0), Ld(0), M(0), N(0), tau(0) {}
+		};
+
+		struct SPPMPixelNode {
+			SPPMPixel* pixel;
+			SPPMPixelNode* next;
+		};
+
+		int maxDepth;
+		//number of iterations, use sample count of sampler if not specified
+		int iterations;
+		//photons per iteration, use pixel count of film if not specified
+		int photonsPerIteration;
+		Float initialRadius;
+		//fraction of new photons to keep
+		Float alpha;
+
+	public:
+		SPPM(const PropSets& props, Scene& scene);
+
+		virtual Vector3f Li(const RayDifferential& ray, const Scene& scene, const Sampler* sampler, AovSample* aov = nullptr) const;
+		virtual void Render(const Scene& scene) const;
+		virtual bool IsBidirectional() const { return true; }
+
+		virtual string ToString() const;
+
+	private:
+		void TraceCameraPath(const Scene& scene, const Sampler* sampler, RayDifferential& ray, SPPMPixel& pixel) const;
+		void TracePhoton(const Scene& scene, const Sampler* sampler, const BBox& gridBounds, const int gridRes[3],
+			const vector<atomic<SPPMPixelNode*>>& grid) const;
+	};
+}
\ No newline at end of file
@@ -8,10 +8,40 @@ namespace pol {
 		:Light(props, scene) {
 		radiance = props.GetVector3f("radiance", Vector3f::Zero());
 		twoside = props.GetBool("twoside", false);
+		area = 0;
 	}
 
 	void Area::SetShape(Shape* s) {
-		shape = s;
+		shapes.push_back(s);
+	}
+
+	void Area::Prepare(const Scene& scene) {
+		if (shapes.empty()) return;
+
+		vector<Float> areas(shapes.size());
+		area = 0;
+		for (int i = 0; i < shapes.size(); ++i) {
+			areas[i] = shapes[i]->SurfaceArea();
+			area += areas[i];
+		}
+
+		areaDistribution = Distribution1D(&areas[0], areas.size());
+	}
+
+	//choose a shape and remap u for sampling the shape
+	const Shape* Area::chooseShape(Float& u, Float& choicePdf) const {
+		if (shapes.size() == 1) {
+			choicePdf = 1;
+			return shapes[0];
+		}
+
+		int idx;
+		Float pdf;
+		Float v = areaDistribution.SampleContinuous(u, pdf, idx);
+		choicePdf = areaDistribution.DiscretePdf(idx);
+		u = Min(Float(v * shapes.size() - idx), Float(0.99999994));
+
+		return shapes[idx];
 	}
 
 	bool Area::IsDelta() const {
@@ -30,7 +60,7 @@ namespace pol {
 	//      = Le*PI*A
 	//A is surface area of shape
 	Float Area::Luminance() const {
-		Vector3f power = radiance * shape->SurfaceArea() * Float(PI);
+		Vector3f power = radiance * area * Float(PI);
 		if (twoside) power *= Float(2);
 
 		return GetLuminance(power);
@@ -39,7 +69,11 @@ namespace pol {
 	void Area::SampleLight(const Intersection& isect, const Vector2f& u, Vector3f& rad, Float& pdf, Ray& shadowRay) const {
 		Vector3f pos = isect.p, nor;
 		bool solidAngle;
-		shape->SampleShape(u, pos, nor, pdf, solidAngle);
+		Float choicePdf;
+		Vector2f v = u;
+		const Shape* shape = chooseShape(v.x, choicePdf);
+		shape->SampleShape(v, pos, nor, pdf, solidAngle);
+		pdf *= choicePdf;
 		Vector3f dir = pos - isect.p;
 		//twoside?
 		if (!twoside && Dot(dir, nor) > 0) {
@@ -57,7 +91,11 @@ namespace pol {
 
 	void Area::SampleLight(const Vector2f& posSample, const Vector2f& dirSample, Vector3f& rad, Vector3f& nor, Ray& emitRay, Float& pdfW, Float& pdfA) const {
 		Vector3f pos;
-		shape->SampleShape(posSample, pos, nor, pdfA);
+		Float choicePdf;
+		Vector2f v = posSample;
+		const Shape* shape = chooseShape(v.x, choicePdf);
+		shape->SampleShape(v, pos, nor, pdfA);
+		pdfA *= choicePdf;
 		Vector3f dir = Warp::CosineHemiSphere(dirSample);
 		pdfW = Warp::CosineHemiSpherePdf(dir);
 		Frame frame(nor);
@@ -69,7 +107,15 @@ namespace pol {
 
 	Float Area::Pdf(const Intersection& isect, const Vector3f& pOnSurface) const {
 		bool solidAngle;
-		Float pdf = shape->Pdf(isect.p, pOnSurface, solidAngle);
+		Float pdf;
+		if (shapes.size() == 1) {
+			pdf = shapes[0]->Pdf(isect.p, pOnSurface, solidAngle);
+		}
+		else {
+			//grouped shapes are triangles of a mesh, which are sampled uniformly by area
+			pdf = 1 / area;
+			solidAngle = false;
+		}
 		if (!solidAngle) {
 			Vector3f dir = pOnSurface - isect.p;
 			Float lensq = dir.LengthSquare();
@@ -80,6 +126,42 @@ namespace pol {
 		return pdf;
 	}
 
+	bool Area::GetBounds(BBox& bbox, Vector3f& axis, Float& cosThetaO, Float& cosThetaE) const {
+		//average axis weighted by area, and the cone covering every shape
+		bbox = BBox();
+		Vector3f sum = Vector3f::Zero();
+		vector<Vector3f> axes(shapes.size());
+		vector<Float> cosThetas(shapes.size());
+		for (int i = 0; i < shapes.size(); ++i) {
+			bbox.Union(shapes[i]->WorldBBox());
+			shapes[i]->NormalBounds(axes[i], cosThetas[i]);
+			sum += axes[i] * shapes[i]->SurfaceArea();
+		}
+
+		if (shapes.size() == 1) {
+			axis = axes[0];
+			cosThetaO = cosThetas[0];
+		}
+		else if (sum.LengthSquare() == 0) {
+			axis = Vector3f::Up();
+			cosThetaO = -1;
+		}
+		else {
+			axis = Normalize(sum);
+			Float thetaO = 0;
+			for (int i = 0; i < shapes.size(); ++i) {
+				Float theta = acos(Clamp(Dot(axis, axes[i]), Float(-1), Float(1))) + acos(Clamp(cosThetas[i], Float(-1), Float(1)));
+				thetaO = Max(thetaO, theta);
+			}
+			cosThetaO = thetaO >= PI ? -1 : cos(thetaO);
+		}
+		//back side emits as well
+		if (twoside) cosThetaO = -1;
+		cosThetaE = 0;
+
+		return true;
+	}
+
 	Vector3f Area::Le(const Vector3f& in, const Vector3f& nor) const {
 		//twoside?
 		if (!twoside && Dot(in, nor) < 0) return Vector3f::Zero();
@@ -90,7 +172,8 @@ namespace pol {
 	string Area::ToString() const {
 		string ret;
 		ret += "Area[\n  radiance = " + radiance.ToString()
-			+ ",\n  shape = " + indent(shape->ToString())
+			+ ",\n  shape count = " + to_string(shapes.size())
+			+ ",\n  shape = " + indent(shapes[0]->ToString())
 			+ ",\n  twoside = " + to_string(twoside)
 			+ "\n]";
 
@@ -2,18 +2,24 @@
 
 #include "../core/light.h"
 #include "../core/shape.h"
+#include "../core/distribution.h"
 
 namespace pol {
 	class Area : public Light {
 	private:
 		Vector3f radiance;
-		Shape* shape;
+		//shapes of light, triangles of mesh share one light
+		vector<Shape*> shapes;
+		//choose shape by surface area
+		Distribution1D areaDistribution;
+		Float area;
 		bool twoside;
 
 	public:
 		Area(const PropSets& props, Scene& scene);
 
 		virtual void SetShape(Shape* s);
+		virtual void Prepare(const Scene& scene);
 		virtual bool IsDelta() const;
 		virtual bool IsInfinite() const;
 		virtual Float Luminance() const;
@@ -23,7 +29,11 @@ namespace pol {
 		virtual Vector3f Le(const Vector3f& in, const Vector3f& nor) const;
 
 		virtual Float Pdf(const Intersection& isect, const Vector3f& pOnSurface) const;
+		virtual bool GetBounds(BBox& bbox, Vector3f& axis, Float& cosThetaO, Float& cosThetaE) const;
 
 		virtual string ToString() const;
+
+	private:
+		const Shape* chooseShape(Float& u, Float& choicePdf) const;
 	};
 }
\ No newline at end of file
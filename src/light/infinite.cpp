@@ -2,19 +2,43 @@
 #include "../core/scene.h"
 #include "../core/imageio.h"
 #include "../core/directory.h"
+#include "../core/parallel.h"
+#include <fstream>
 
 namespace pol {
 	POL_REGISTER_CLASS(Infinite, "infinite");
 
+	static const char distCacheMagic[4] = { 'P', 'D', 'S', 'T' };
+
 	Infinite::Infinite(const PropSets& props, Scene& scene)
 		:Light(props, scene) {
 		world = GetWorldTransform(props);
 		string file = props.GetString("file");
+		string fullPath = Directory::GetFullPath(file);
+		//half keeps enough range for hdr environment and halves memory
+		TexelFormat format = props.GetString("format", "float") == "half" ? TexelFormat::E_RGB16F : TexelFormat::E_RGB32F;
+		string key = fullPath + "|exr|" + to_string(int(format));
+		image = scene.GetMipmap(key, [&](Mipmap& mipmap) {
+			int w, h;
+			vector<Vector3f> data;
+			ImageIO::LoadExr(fullPath.c_str(), w, h, data);
+			mipmap.Build(w, h, data, FilterMode::E_LINEAR, WrapMode::E_REPEAT, format);
+			});
+
+		int downsample = Max(props.GetInt("distributionDownsample", 1), 1);
+		bool cache = props.GetBool("distributionCache", true);
+		string cacheFile = fullPath + ".dist";
+		if (cache && loadDistribution(cacheFile, fullPath, downsample)) return;
+
+		//mipmap may be shared, so texels are read back from it
 		int w, h;
 		vector<Vector3f> data;
-		ImageIO::LoadExr((Directory::GetFullPath(file)).c_str(), w, h, data);
-		image.Build(w, h, data, FilterMode::E_LINEAR, WrapMode::E_REPEAT);
+		image->GetLevel(0, w, h, data);
+		buildDistribution(w, h, data, downsample);
+		if (cache) saveDistribution(cacheFile, fullPath, downsample);
+	}
 
+	void Infinite::buildDistribution(int w, int h, const vector<Vector3f>& data, int downsample) {
 		//consider, for example, a constant-valued environment map: with the p(u,v)
 		//sampling technique, all(theta, phi) values are equally likely to be chosen.
 		//Due to the maping to directions on the sphere, however, this would lead to 
@@ -25,19 +49,68 @@ namespace pol {
 		//Given this state of affairs, however, it's better to have modified the p(u,v)
 		//sampling distribution so that it's less likely to select directions near the
 		//poles in the first place.
-		vector<Float> func(w * h);
-		for (int i = 0; i < h; ++i) {
-			Float v = Float(i) / h;
-			Float theta = v * PI;
+		int dw = Max(w / downsample, 1);
+		int dh = Max(h / downsample, 1);
+		vector<Float> func(dw * dh);
+		Parallel::ParallelFor([&](int i) {
+			int y0 = i * h / dh, y1 = (i + 1) * h / dh;
+			//sin(theta) at center of row
+			Float theta = (i + Float(0.5)) / dh * PI;
 			Float sintheta = sin(theta);
-			for (int j = 0; j < w; ++j) {
-				Float u = Float(j) / w;
-				int idx = i * w + j;
-				func[idx] = GetLuminance(data[idx]) * sintheta;
+			for (int j = 0; j < dw; ++j) {
+				int x0 = j * w / dw, x1 = (j + 1) * w / dw;
+				Float sum = 0;
+				for (int y = y0; y < y1; ++y) {
+					for (int x = x0; x < x1; ++x) {
+						sum += GetLuminance(data[y * w + x]);
+					}
+				}
+
+				func[i * dw + j] = sum / ((y1 - y0) * (x1 - x0)) * sintheta;
 			}
+			}, dh, 16);
+
+		distribution = Distribution2D(&func[0], dw, dh);
+	}
+
+	bool Infinite::loadDistribution(const string& cacheFile, const string& imageFile, int downsample) {
+		int64_t size, time;
+		if (!Directory::GetFileStamp(imageFile, size, time)) return false;
+
+		ifstream in(cacheFile, ios::binary);
+		if (!in) return false;
+
+		char magic[4];
+		int64_t fileSize = 0, fileTime = 0;
+		int fileDownsample = 0;
+		in.read(magic, 4);
+		in.read((char*)&fileSize, sizeof(int64_t));
+		in.read((char*)&fileTime, sizeof(int64_t));
+		in.read((char*)&fileDownsample, sizeof(int));
+		if (!in || memcmp(magic, distCacheMagic, 4) || fileSize != size || fileTime != time || fileDownsample != downsample) return false;
+
+		//same size as buildDistribution, so a broken cache is never trusted
+		TexInfo level = image->GetPyramid()[0];
+		int dw = Max(level.w / downsample, 1);
+		int dh = Max(level.h / downsample, 1);
+		return distribution.Read(in, dw, dh);
+	}
+
+	void Infinite::saveDistribution(const string& cacheFile, const string& imageFile, int downsample) const {
+		int64_t size, time;
+		if (!Directory::GetFileStamp(imageFile, size, time)) return;
+
+		ofstream out(cacheFile, ios::binary);
+		if (!out) {
+			fprintf(stderr, "Can not write distribution cache [%s]\n", cacheFile.c_str());
+			return;
 		}
 
-		distribution = Distribution2D(&func[0], w, h);
+		out.write(distCacheMagic, 4);
+		out.write((const char*)&size, sizeof(int64_t));
+		out.write((const char*)&time, sizeof(int64_t));
+		out.write((const char*)&downsample, sizeof(int));
+		distribution.Write(out);
 	}
 
 	void Infinite::Prepare(const Scene& scene) {
@@ -60,13 +133,13 @@ namespace pol {
 	//      = Le*4*PI*A
 	//      = Le*4*PI*PI*radius*radius
 	Float Infinite::Luminance() const {
-		Vector3f power = Float(FOURPI) * Float(PI) * radius * radius * image.Lookup(Vector2f(0.5, 0.5));
+		Vector3f power = Float(FOURPI) * Float(PI) * radius * radius * image->Lookup(Vector2f(0.5, 0.5));
 	
 		return GetLuminance(power);
 	}
 
 	void Infinite::SampleLight(const Intersection& isect, const Vector2f& u, Vector3f& rad, Float& pdf, Ray& shadowRay) const {
-		Vector2f uv = distribution.SampleContinuous(u, pdf);
+		Vector2f uv = distribution.SampleAlias(u, pdf);
 		Float theta = uv.y * PI;
 		Float phi = uv.x * TWOPI;
 		Float sintheta = sin(theta);
@@ -78,14 +151,14 @@ namespace pol {
 		//transform dir to world space
 		//transformation should not contain scale component
 		dir = world.TransformVector(dir);
-		rad = image.Lookup(uv);
+		rad = image->Lookup(uv);
 		//p(w) = p(theta, phi) / sintheta = p(u, v) / (TWOPI * sintheta)
 		pdf /= (TWOPI * PI * sintheta);
 		shadowRay = Ray(isect.p, dir);
 	}
 
 	void Infinite::SampleLight(const Vector2f& posSample, const Vector2f& dirSample, Vector3f& rad, Vector3f& nor, Ray& emitRay, Float& pdfA, Float& pdfW) const {
-		Vector2f uv = distribution.SampleContinuous(dirSample, pdfW);
+		Vector2f uv = distribution.SampleAlias(dirSample, pdfW);
 		Float theta = uv.y * PI;
 		Float phi = uv.x * TWOPI;
 		Float sintheta = sin(theta);
@@ -99,7 +172,7 @@ namespace pol {
 		Vector2f diskPos = Warp::ConcentricDisk(posSample) * radius;
 		Vector3f pos = frame.ToWorld(Vector3f(diskPos.x, 0, diskPos.y));
 		pos += radius * dir + center;
-		rad = image.Lookup(uv);
+		rad = image->Lookup(uv);
 		nor = -dir;
 		emitRay = Ray(pos, nor);
 		pdfW /= (TWOPI * PI * sintheta);
@@ -128,13 +201,13 @@ namespace pol {
 		Float u = phi * INV2PI;
 		Float v = theta * INVPI;
 
-		return image.Lookup(Vector2f(u, v));
+		return image->Lookup(Vector2f(u, v));
 	}
 
 	string Infinite::ToString() const {
 		string ret;
 		ret += "Infinite[\n  world = " + indent(world.ToString())
-			+ ",\n  image = " + indent(image.ToString())
+			+ ",\n  image = " + indent(image->ToString())
 			+ "\n]";
 
 		return ret;
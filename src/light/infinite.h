@@ -7,7 +7,8 @@
 namespace pol {
 	class Infinite : public Light {
 	private:
-		Mipmap image;
+		//shared with other lights and textures of same file
+		const Mipmap* image;
 		Distribution2D distribution;
 
 		//local to world transform
@@ -30,5 +31,14 @@ namespace pol {
 		virtual Vector3f Le(const Vector3f& in, const Vector3f& nor) const;
 
 		virtual string ToString() const;
+
+	private:
+		//build sampling distribution, downsample is the texel count per side
+		//of a block, whose average luminance is one entry of distribution
+		void buildDistribution(int w, int h, const vector<Vector3f>& data, int downsample);
+		//cache of distribution is stored next to image, and keyed by size and
+		//modified time of image file, so image is not read when cache is valid
+		bool loadDistribution(const string& cacheFile, const string& imageFile, int downsample);
+		void saveDistribution(const string& cacheFile, const string& imageFile, int downsample) const;
 	};
 }
\ No newline at end of file
@@ -48,6 +48,16 @@ namespace pol {
 		pdfW = Warp::UniformSpherePdf(dir);
 	}
 
+	//emit in all directions
+	bool Point::GetBounds(BBox& bbox, Vector3f& axis, Float& cosThetaO, Float& cosThetaE) const {
+		bbox = BBox(position, position);
+		axis = Vector3f::Up();
+		cosThetaO = -1;
+		cosThetaE = 0;
+
+		return true;
+	}
+
 	Float Point::Pdf(const Intersection& isect, const Vector3f& pOnSurface) const {
 		return 0;
 	}
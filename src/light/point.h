@@ -18,6 +18,7 @@ namespace pol {
 		virtual void SampleLight(const Vector2f& posSample, const Vector2f& dirSample, Vector3f& rad, Vector3f& nor, Ray& emitRay, Float& pdfW, Float& pdfA) const;
 		
 		virtual Float Pdf(const Intersection& isect, const Vector3f& pOnSurface) const;
+		virtual bool GetBounds(BBox& bbox, Vector3f& axis, Float& cosThetaO, Float& cosThetaE) const;
 
 		virtual string ToString() const;
 	};
@@ -63,6 +63,16 @@ namespace pol {
 		return 0;
 	}
 
+	//full radiance inside falloff cone, and fade out to total cone
+	bool Spot::GetBounds(BBox& bbox, Vector3f& axis, Float& cosThetaO, Float& cosThetaE) const {
+		bbox = BBox(position, position);
+		axis = direction;
+		cosThetaO = falloff;
+		cosThetaE = cos(acos(total) - acos(falloff));
+
+		return true;
+	}
+
 	Float Spot::getFalloff(Float val) const {
 		if (val < total) return 0;
 		if (val > falloff) return 1;
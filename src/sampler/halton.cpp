@@ -0,0 +1,72 @@
+#include "halton.h"
+
+namespace pol {
+	POL_REGISTER_CLASS(Halton, "halton");
+
+	Halton::Halton(const PropSets& props, Scene& scene)
+		:Sampler(props, scene), startIndex(0), haltonIndex(0), dimension(0) {
+		//build permutation tables before rendering
+		GetRadicalInversePermutation(0);
+	}
+
+	void Halton::Prepare(uint64_t idx) {
+		rng.Seed(idx);
+		//keep offset small enough, so that radical inverse has few digits
+		startIndex = MixBits(idx) >> 40;
+		haltonIndex = startIndex;
+		dimension = 0;
+	}
+
+	//the first four dimensions are used by camera samples
+	void Halton::SetSampleIndex(int idx) {
+		haltonIndex = startIndex + idx;
+		dimension = 4;
+	}
+
+	Float Halton::Next1D() const {
+		return sampleDimension(haltonIndex, dimension++);
+	}
+
+	Vector2f Halton::Next2D() const {
+		Float x = sampleDimension(haltonIndex, dimension++);
+		Float y = sampleDimension(haltonIndex, dimension++);
+		return Vector2f(x, y);
+	}
+
+	void Halton::GetCameraSamples(CameraSample* samples, int count) const {
+		for (int i = 0; i < count; ++i) {
+			uint64_t idx = startIndex + i;
+			samples[i].film = Vector2f(sampleDimension(idx, 0), sampleDimension(idx, 1));
+			samples[i].lens = Vector2f(sampleDimension(idx, 2), sampleDimension(idx, 3));
+		}
+	}
+
+	void Halton::Next1DArray(Float* u, int n) const {
+		for (int i = 0; i < n; ++i) u[i] = sampleDimension(haltonIndex, dimension++);
+	}
+
+	void Halton::Next2DArray(Vector2f* u, int n) const {
+		for (int i = 0; i < n; ++i) {
+			Float x = sampleDimension(haltonIndex, dimension++);
+			Float y = sampleDimension(haltonIndex, dimension++);
+			u[i] = Vector2f(x, y);
+		}
+	}
+
+	Sampler* Halton::Clone() const {
+		return new Halton(*this);
+	}
+
+	Float Halton::sampleDimension(uint64_t idx, int dim) const {
+		if (dim >= SpecializedPrimeCount) return rng.UniformFloat();
+
+		return ScrambledRadicalInverse(dim, idx, GetRadicalInversePermutation(dim));
+	}
+
+	//return a human-readable string summary
+	string Halton::ToString() const {
+		string ret;
+		ret = "Halton[\n  SampleCount = " + to_string(sampleCount) + "\n]";
+		return ret;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../core/sampler.h"
+
+namespace pol {
+	//halton sampler with random digit permutations
+	//dimension i uses radical inverse in base of the i-th prime, each pixel
+	//starts at a random offset of the sequence, and consecutive points of
+	//halton sequence are well stratified in each dimension
+	//dimensions beyond the specialized prime bases fall back to random numbers
+	class Halton : public Sampler {
+	private:
+		mutable Rng rng;
+		mutable uint64_t startIndex;
+		mutable uint64_t haltonIndex;
+		mutable int dimension;
+
+	public:
+		Halton(const PropSets& props, Scene& scene);
+
+		virtual void Prepare(uint64_t idx);
+		virtual void SetSampleIndex(int idx);
+		virtual Float Next1D() const;
+		virtual Vector2f Next2D() const;
+		virtual void GetCameraSamples(CameraSample* samples, int count) const;
+		virtual void Next1DArray(Float* u, int n) const;
+		virtual void Next2DArray(Vector2f* u, int n) const;
+		virtual Sampler* Clone() const;
+
+		virtual string ToString() const;
+
+	private:
+		Float sampleDimension(uint64_t idx, int dim) const;
+	};
+}
\ No newline at end of file
@@ -4,20 +4,45 @@ namespace pol {
 	POL_REGISTER_CLASS(Random, "random");
 
 	Random::Random(const PropSets& props, Scene& scene)
-		:Sampler(props, scene) {
+		:Sampler(props, scene), cursor(RngSIMD::Lanes) {
 
 	}
 
 	void Random::Prepare(uint64_t idx) {
 		rng.Seed(idx);
+		cursor = RngSIMD::Lanes;
 	}
 
 	Float Random::Next1D() const {
-		return rng.UniformFloat();
+		if (cursor == RngSIMD::Lanes) {
+			rng.UniformFloat(buffer, RngSIMD::Lanes);
+			cursor = 0;
+		}
+
+		return buffer[cursor++];
 	}
 
 	Vector2f Random::Next2D() const {
-		return Vector2f(rng.UniformFloat(), rng.UniformFloat());
+		Float x = Next1D();
+		Float y = Next1D();
+		return Vector2f(x, y);
+	}
+
+	void Random::GetCameraSamples(CameraSample* samples, int count) const {
+		static_assert(sizeof(CameraSample) == 4 * sizeof(Float), "camera sample must be tightly packed");
+		Next1DArray(reinterpret_cast<Float*>(samples), 4 * count);
+	}
+
+	//drain buffered numbers first, then generate the rest in blocks
+	void Random::Next1DArray(Float* u, int n) const {
+		int i = 0;
+		for (; i < n && cursor < RngSIMD::Lanes; ++i) u[i] = buffer[cursor++];
+		if (i < n) rng.UniformFloat(u + i, n - i);
+	}
+
+	void Random::Next2DArray(Vector2f* u, int n) const {
+		static_assert(sizeof(Vector2f) == 2 * sizeof(Float), "vector2f must be tightly packed");
+		Next1DArray(reinterpret_cast<Float*>(u), 2 * n);
 	}
 
 	Sampler* Random::Clone() const {
@@ -3,9 +3,13 @@
 #include "../core/sampler.h"
 
 namespace pol {
+	//numbers are generated by SIMD streams a block at a time,
+	//and buffered for scalar requests
 	class Random : public Sampler {
 	private:
-		Rng rng;
+		RngSIMD rng;
+		mutable Float buffer[RngSIMD::Lanes];
+		mutable int cursor;
 
 	public:
 		Random(const PropSets& props, Scene& scene);
@@ -13,6 +17,9 @@ namespace pol {
 		virtual void Prepare(uint64_t idx);
 		virtual Float Next1D() const;
 		virtual Vector2f Next2D() const;
+		virtual void GetCameraSamples(CameraSample* samples, int count) const;
+		virtual void Next1DArray(Float* u, int n) const;
+		virtual void Next2DArray(Vector2f* u, int n) const;
 		virtual Sampler* Clone() const;
 
 		virtual string ToString() const;
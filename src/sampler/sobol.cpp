@@ -0,0 +1,125 @@
+#include "sobol.h"
+
+namespace pol {
+	POL_REGISTER_CLASS(Sobol, "sobol");
+
+	static __forceinline uint32_t ReverseBits(uint32_t v) {
+		v = (v << 16) | (v >> 16);
+		v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+		v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+		v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+		v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+		return v;
+	}
+
+	//laine-karras style permutation, it only propagates bits from lower to higher,
+	//so it is an owen scrambling of bit reversed value
+	static __forceinline uint32_t LaineKarrasPermutation(uint32_t v, uint32_t seed) {
+		v += seed;
+		v ^= v * 0x6c50b47cu;
+		v ^= v * 0xb82f1e52u;
+		v ^= v * 0xc7afe638u;
+		v ^= v * 0x8d22f6e6u;
+		return v;
+	}
+
+	//owen scrambling of fixed point value, flipping of each bit depends on all higher bits
+	static __forceinline uint32_t OwenScramble(uint32_t v, uint32_t seed) {
+		return ReverseBits(LaineKarrasPermutation(ReverseBits(v), seed));
+	}
+
+	//first dimension of sobol sequence is van der corput sequence
+	static __forceinline uint32_t SobolDimension0(uint32_t idx) {
+		return ReverseBits(idx);
+	}
+
+	//second dimension is generated by primitive polynomial x + 1,
+	//direction numbers are v(i) = v(i - 1) ^ (v(i - 1) >> 1)
+	static __forceinline uint32_t SobolDimension1(uint32_t idx) {
+		uint32_t ret = 0;
+		for (uint32_t v = 1u << 31; idx; idx >>= 1, v ^= v >> 1) {
+			if (idx & 1) ret ^= v;
+		}
+
+		return ret;
+	}
+
+	static __forceinline Float ToFloat(uint32_t v) {
+		return Min(Float(0.99999994), Float(v * 2.3283064365386963e-10f));
+	}
+
+	Sobol::Sobol(const PropSets& props, Scene& scene)
+		:Sampler(props, scene), seed(0), sampleIndex(0), dimension(0) {
+		if (sampleCount & (sampleCount - 1)) {
+			int count = 1;
+			while (count < sampleCount) count <<= 1;
+			fprintf(stderr, "Sobol sampler: sample count [%d] is rounded up to [%d]\n", sampleCount, count);
+			sampleCount = count;
+		}
+	}
+
+	void Sobol::Prepare(uint64_t idx) {
+		seed = MixBits(idx);
+		sampleIndex = 0;
+		dimension = 0;
+	}
+
+	//the first two dimensions are used by camera samples
+	void Sobol::SetSampleIndex(int idx) {
+		sampleIndex = idx;
+		dimension = 2;
+	}
+
+	Float Sobol::Next1D() const {
+		return sample1D(sampleIndex, dimension++);
+	}
+
+	Vector2f Sobol::Next2D() const {
+		return sample2D(sampleIndex, dimension++);
+	}
+
+	void Sobol::GetCameraSamples(CameraSample* samples, int count) const {
+		for (int i = 0; i < count; ++i) {
+			samples[i].film = sample2D(i, 0);
+			samples[i].lens = sample2D(i, 1);
+		}
+	}
+
+	void Sobol::Next1DArray(Float* u, int n) const {
+		for (int i = 0; i < n; ++i) u[i] = sample1D(sampleIndex, dimension++);
+	}
+
+	void Sobol::Next2DArray(Vector2f* u, int n) const {
+		for (int i = 0; i < n; ++i) u[i] = sample2D(sampleIndex, dimension++);
+	}
+
+	Sampler* Sobol::Clone() const {
+		return new Sobol(*this);
+	}
+
+	uint32_t Sobol::dimensionSeed(uint32_t dim) const {
+		return uint32_t(MixBits(seed ^ (uint64_t(dim) * 0x9e3779b97f4a7c15ULL)));
+	}
+
+	Float Sobol::sample1D(uint32_t idx, uint32_t dim) const {
+		uint32_t hash = dimensionSeed(dim);
+		uint32_t shuffled = OwenScramble(idx, hash);
+		return ToFloat(OwenScramble(SobolDimension0(shuffled), uint32_t(MixBits(hash))));
+	}
+
+	Vector2f Sobol::sample2D(uint32_t idx, uint32_t dim) const {
+		uint32_t hash = dimensionSeed(dim);
+		uint32_t shuffled = OwenScramble(idx, hash);
+		uint64_t scramble = MixBits(hash);
+		uint32_t x = OwenScramble(SobolDimension0(shuffled), uint32_t(scramble));
+		uint32_t y = OwenScramble(SobolDimension1(shuffled), uint32_t(scramble >> 32));
+		return Vector2f(ToFloat(x), ToFloat(y));
+	}
+
+	//return a human-readable string summary
+	string Sobol::ToString() const {
+		string ret;
+		ret = "Sobol[\n  SampleCount = " + to_string(sampleCount) + "\n]";
+		return ret;
+	}
+}
\ No newline at end of file
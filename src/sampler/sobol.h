@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../core/sampler.h"
+
+namespace pol {
+	//sobol sampler with hash-based owen scrambling
+	//every pair of dimensions is taken from the first two dimensions of sobol
+	//sequence, which form a (0, 2)-sequence in base 2. the sample index is
+	//shuffled and each dimension is owen scrambled with different seeds, so
+	//pairs are decorrelated from each other while stratification is kept
+	//sample count should be power of 2
+	class Sobol : public Sampler {
+	private:
+		//scramble seed of current pixel
+		mutable uint64_t seed;
+		mutable uint32_t sampleIndex;
+		mutable uint32_t dimension;
+
+	public:
+		Sobol(const PropSets& props, Scene& scene);
+
+		virtual void Prepare(uint64_t idx);
+		virtual void SetSampleIndex(int idx);
+		virtual Float Next1D() const;
+		virtual Vector2f Next2D() const;
+		virtual void GetCameraSamples(CameraSample* samples, int count) const;
+		virtual void Next1DArray(Float* u, int n) const;
+		virtual void Next2DArray(Vector2f* u, int n) const;
+		virtual Sampler* Clone() const;
+
+		virtual string ToString() const;
+
+	private:
+		uint32_t dimensionSeed(uint32_t dim) const;
+		Float sample1D(uint32_t idx, uint32_t dim) const;
+		Vector2f sample2D(uint32_t idx, uint32_t dim) const;
+	};
+}
\ No newline at end of file
@@ -115,6 +115,11 @@ namespace pol {
 		return 1 / SurfaceArea();
 	}
 
+	void Disk::NormalBounds(Vector3f& axis, Float& cosTheta) const {
+		axis = Normalize(normal);
+		cosTheta = 1;
+	}
+
 	string Disk::ToString() const {
 		string ret;
 		ret += "Disk[\n  world = " + indent(world.ToString())
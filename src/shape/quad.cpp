@@ -110,6 +110,11 @@ namespace pol {
 		return 1 / SurfaceArea();
 	}
 
+	void Quad::NormalBounds(Vector3f& axis, Float& cosTheta) const {
+		axis = Normalize(normal);
+		cosTheta = 1;
+	}
+
 	string Quad::ToString() const {
 		string ret;
 		ret += "Quad[\n  world = " + indent(world.ToString())
@@ -4,6 +4,7 @@
 #include "../core/meshio.h"
 #include "../core/scene.h"
 #include "../core/directory.h"
+#include "../core/parallel.h"
 
 namespace pol {
 	POL_REGISTER_CLASS(TriangleMesh, "trianglemesh");
@@ -19,7 +20,9 @@ namespace pol {
 		else {
 			//load mesh
 			string file = props.GetString("file");
-			MeshIO::LoadModelFromFile(p, n, uv, indices, (Directory::GetFullPath(file)).c_str());
+			bool cache = props.GetBool("meshCache", true);
+			MeshIO::LoadModelFromFile(p, n, uv, indices, (Directory::GetFullPath(file)).c_str(),
+				aiProcess_Triangulate | aiProcess_GenSmoothNormals, cache);
 			if (props.HasValue("subdivision")) {
 				int level = props.GetInt("level", 4);
 				CreateSubDivisionShape(level, this);
@@ -27,8 +30,10 @@ namespace pol {
 		}
 
 		//transform triangle mesh to world space
-		for (Vector3f& vertex : this->p) {
-			vertex = world.TransformPoint(vertex);
+		Parallel::ParallelFor([&](int i) {
+			this->p[i] = world.TransformPoint(this->p[i]);
+			}, this->p.size(), 4096);
+		for (const Vector3f& vertex : this->p) {
 			bbox.Union(vertex);
 		}
 
@@ -53,9 +58,9 @@ namespace pol {
 			}
 		}
 		else {
-			for (Vector3f& normal : this->n) {
-				normal = world.TransformNormal(normal);
-			}
+			Parallel::ParallelFor([&](int i) {
+				this->n[i] = world.TransformNormal(this->n[i]);
+				}, this->n.size(), 4096);
 		}
 
 		hasTexcoord = uv.size() != 0;
@@ -312,6 +317,16 @@ namespace pol {
 		return 1 / SurfaceArea();
 	}
 
+	//cone around averaged vertex normal
+	void Triangle::NormalBounds(Vector3f& axis, Float& cosTheta) const {
+		Vector3f n1 = mesh->n[mesh->indices[faceIndex + 0]];
+		Vector3f n2 = mesh->n[mesh->indices[faceIndex + 1]];
+		Vector3f n3 = mesh->n[mesh->indices[faceIndex + 2]];
+
+		axis = Normalize(n1 + n2 + n3);
+		cosTheta = Min(Dot(axis, n1), Min(Dot(axis, n2), Dot(axis, n3)));
+	}
+
 	//return a human-readable string summary
 	string Triangle::ToString() const {
 		string ret = "";
@@ -41,6 +41,7 @@ namespace pol {
 		virtual void SampleShape(const Vector2f& u, Vector3f& pos, Vector3f& nor, Float& pdf, bool& solidAngle) const;
 		virtual void SampleShape(const Vector2f& u, Vector3f& pos, Vector3f& nor, Float& pdfA) const;
 		virtual Float Pdf(const Vector3f& pOnLight, const Vector3f& pOnSurface, bool& solidAngle) const;
+		virtual void NormalBounds(Vector3f& axis, Float& cosTheta) const;
 
 		//return a human-readable string summary
 		virtual string ToString() const;
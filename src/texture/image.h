@@ -4,22 +4,25 @@
 #include "../core/mipmap.h"
 #include "../core/imageio.h"
 #include "../core/directory.h"
+#include "../core/texturecache.h"
+#include "../core/scene.h"
 
 namespace pol {
 	class Image : public Texture {
 	private:
-		Mipmap image;
+		//shared by all textures of same file
+		const Mipmap* image;
 
 	public:
 		Image(const PropSets& props, Scene& scene)
-			:Texture(props, scene) {
+			:Texture(props, scene), image(nullptr) {
 			string file = props.GetString("file");
 			if (file == "") {
 				fprintf(stderr, "Please specific file name\n");
 				return;
 			}
 			bool srgb = props.GetBool("srgb", true);
-			string filtermode = props.GetString("filtermode", "trilinear");
+			string filtermode = props.GetString("filtermode", "ewa");
 			string wrapmode = props.GetString("wrapmode", "repeat");
 			FilterMode fmode;
 			if (filtermode == "nearst") fmode = FilterMode::E_NEARST;
@@ -35,22 +38,55 @@ namespace pol {
 			else wmode = WrapMode::E_REPEAT;
 
 			bool flip = props.GetBool("flip", true);
-			
-			int w, h;
-			vector<Vector3f> data;
-			ImageIO::LoadTexture(Directory::GetFullPath(file).c_str(), w, h, srgb, flip, data);
+			Float maxAnisotropy = props.GetFloat("maxAnisotropy", 8);
+			string texelformat = props.GetString("format", "auto");
+			bool tiled = props.GetBool("tiled", TextureCache::IsEnabled());
+			string fullPath = Directory::GetFullPath(file);
 
-			//build mipmap
-			image.Build(w, h, data, fmode, wmode);
+			//textures with same file and parameters share one mipmap
+			string key = fullPath + "|" + to_string(srgb) + "|" + to_string(flip)
+				+ "|" + to_string(int(fmode)) + "|" + to_string(int(wmode)) + "|" + texelformat
+				+ "|" + to_string(tiled) + "|" + to_string(maxAnisotropy);
+			image = scene.GetMipmap(key, [&](Mipmap& mipmap) {
+				mipmap.SetMaxAnisotropy(maxAnisotropy);
+
+				//tiled image is paged from cache file, channel count of source
+				//is unknown before conversion, so auto format is rgb8
+				if (tiled) {
+					TexelFormat format;
+					if (texelformat == "float") format = TexelFormat::E_RGB32F;
+					else if (texelformat == "half") format = TexelFormat::E_RGB16F;
+					else if (texelformat == "r8") format = TexelFormat::E_R8;
+					else format = TexelFormat::E_RGB8;
+
+					if (mipmap.BuildTiled(fullPath, srgb, flip, fmode, wmode, format)) return;
+					fprintf(stderr, "Texture [%s] is loaded into memory\n", file.c_str());
+				}
+
+				int w, h, components;
+				vector<Vector3f> data;
+				ImageIO::LoadTexture(fullPath.c_str(), w, h, srgb, flip, data, &components);
+
+				//8-bit sources are stored in 8-bit by default, which is lossless
+				TexelFormat format;
+				if (texelformat == "float") format = TexelFormat::E_RGB32F;
+				else if (texelformat == "half") format = TexelFormat::E_RGB16F;
+				else if (texelformat == "rgb8") format = TexelFormat::E_RGB8;
+				else if (texelformat == "r8") format = TexelFormat::E_R8;
+				else format = components <= 2 ? TexelFormat::E_R8 : TexelFormat::E_RGB8;
+
+				//build mipmap
+				mipmap.Build(w, h, data, fmode, wmode, format, srgb);
+				});
 		}
 
 		Vector3f Evaluate(const Intersection& isect) const {
-			return image.Lookup(isect);
+			return image->Lookup(isect);
 		}
 
 		string ToString() const {
 			string ret;
-			ret += "Image[\n  " + indent(image.ToString())
+			ret += "Image[\n  " + indent(image->ToString())
 				+ "\n]";
 
 			return ret;